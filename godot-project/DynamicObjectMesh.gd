@@ -2,36 +2,65 @@ extends MeshInstance3D
 
 var dynamic_objects = DynamicObjects.new()
 var only_known_object = true
+# Draw boxes and cylinders as MultiMesh instances of unit shapes
+@export var use_instancing: bool = true
+var box_multimesh = MultiMesh.new()
+# Render the objects this many seconds in the past, interpolated between messages
+@export var smooth_motion: bool = true
+@export var render_delay: float = 0.1
+var cylinder_multimesh = MultiMesh.new()
 
 func _ready():
+	if use_instancing:
+		var box_mesh = BoxMesh.new()
+		box_mesh.size = Vector3(1, 1, 1)
+		box_multimesh.mesh = box_mesh
+		var cylinder_mesh = CylinderMesh.new()
+		cylinder_mesh.top_radius = 0.5
+		cylinder_mesh.bottom_radius = 0.5
+		cylinder_mesh.height = 1.0
+		cylinder_mesh.radial_segments = 12
+		cylinder_mesh.rings = 1
+		cylinder_multimesh.mesh = cylinder_mesh
+		for multimesh in [box_multimesh, cylinder_multimesh]:
+			var multimesh_instance = MultiMeshInstance3D.new()
+			multimesh_instance.multimesh = multimesh
+			multimesh_instance.material_override = material_override
+			add_child(multimesh_instance)
+	enable_precompute()
+	if use_instancing and smooth_motion:
+		dynamic_objects.history_size = 4
 	dynamic_objects.subscribe("/perception/object_recognition/objects", false)
+	dynamic_objects.attach_to_snapshot(owner.frame_snapshot, "objects")
 
 func _process(_delta):
+	# Objects move between messages, so they are rewritten every frame
+	if use_instancing and smooth_motion:
+		var render_time = dynamic_objects.get_ros_time() - render_delay
+		dynamic_objects.update_multimesh_at(render_time, box_multimesh, cylinder_multimesh, self, only_known_object)
+		# A new message is interpolated towards from the first frame after it arrives
+		if dynamic_objects.has_new():
+			dynamic_objects.set_old()
+		return
 	if !dynamic_objects.has_new():
 		return
 
-	var arr = []
-	arr.resize(Mesh.ARRAY_MAX)
-	var verts = PackedVector3Array()
-#	var uvs = PoolVector2Array()
-	var normals = PackedVector3Array()
-#	var indices = PoolIntArray()
-
-	var triangle_list = dynamic_objects.get_triangle_list(only_known_object)
-
-	for point in triangle_list:
-		verts.append(point["position"])
-		normals.append(point["normal"])
-
-	arr[Mesh.ARRAY_VERTEX] = verts
-	arr[Mesh.ARRAY_NORMAL] = normals
-#	arr[Mesh.ARRAY_INDEX] = indices	
-#	arr[Mesh.ARRAY_TEX_UV] = uvs
-
-	if !verts.is_empty():
-		mesh.clear_surfaces()
-		mesh.add_surface_from_arrays(Mesh.PRIMITIVE_TRIANGLES, arr)
+	# Rewrites the persistent buffers of this node's mesh
+	if use_instancing:
+		dynamic_objects.update_multimesh(box_multimesh, cylinder_multimesh, self, only_known_object)
+	else:
+		dynamic_objects.update_mesh(self, only_known_object)
 	dynamic_objects.set_old()
 
+# Smooth motion rebuilds the instances from the history every frame, so nothing is precomputed
+func enable_precompute():
+	if use_instancing and smooth_motion:
+		return
+	if use_instancing:
+		dynamic_objects.enable_instances_precompute(only_known_object)
+	else:
+		dynamic_objects.enable_precompute(only_known_object)
+
 func _on_OnlyKnownObjectCheckButton_toggled(button_pressed):
 	only_known_object = button_pressed
+	enable_precompute()
@@ -1,6 +1,9 @@
 extends Node3D
 
 @export var tire_radius: float = 0.378
+# Render the ego pose this many seconds in the past, interpolated between TF updates
+@export var smooth_motion: bool = true
+@export var render_delay: float = 0.1
 
 var ego_pose = EgoPose.new()
 var vehicle_status = VehicleStatus.new()
@@ -26,8 +29,11 @@ func _ready():
 
 func _process(delta):
 	# Ego pose
-	set_position(ego_pose.get_ego_position())
-	set_rotation(ego_pose.get_ego_rotation())
+	var pose = ego_pose.get_ego_pose()
+	if smooth_motion:
+		pose = ego_pose.get_ego_pose_at(ego_pose.get_ros_time() - render_delay)
+	set_position(pose["position"])
+	set_rotation(pose["rotation"])
 	
 	# Tire rotation
 	if(velocity_report.has_new()):
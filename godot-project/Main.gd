@@ -1,12 +1,27 @@
 extends Node3D
 
+# Process ROS 2 callbacks on a background executor instead of once per frame
+@export var spin_in_background: bool = true
+# Number of executor threads (0: number of hardware threads)
+@export var spin_threads: int = 0
+
 var spinner = GodotRviz2Spinner.new()
+# Pins the messages of the attached visualizers once per frame, see FrameSnapshot
+var frame_snapshot = FrameSnapshot.new()
 
 func _ready():
 	$Menu/RenderingQuality/MSAASlider.set_value(get_viewport().get_msaa_3d())
+	if spin_in_background:
+		spinner.start(spin_threads)
 
 func _process(_delta):
-	spinner.spin_some()
+	if not spinner.is_running():
+		spinner.spin_some()
+	# Runs before the children process, so they all convert the same set of messages
+	frame_snapshot.capture()
+
+func _exit_tree():
+	spinner.stop()
 
 func _on_TextureButton_pressed():
 	pass # Replace with function body.
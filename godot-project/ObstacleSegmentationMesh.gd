@@ -4,8 +4,12 @@ var pointcloud = PointCloud.new()
 var sum_time = 0.0
 var transparency_speed = 4.0
 var cycle_time = 3.0
+# Point field that colors the cloud, e.g. "intensity" or "z". The material has to use vertex colors
+@export var color_field: String = ""
 
 func _ready():
+	pointcloud.color_field = color_field
+	pointcloud.enable_precompute("map")
 	pointcloud.subscribe("/perception/obstacle_segmentation/pointcloud", false)
 
 func _process(delta):
@@ -13,19 +17,8 @@ func _process(delta):
 	if !pointcloud.has_new():
 		return
 
-	var arr = []
-	arr.resize(Mesh.ARRAY_MAX)
-	var verts = PackedVector3Array()
-#	var uvs = PoolVector2Array()
-#	var normals = PoolVector3Array()
-#	var indices = PoolIntArray()
-
-	verts = pointcloud.get_pointcloud("map")
-#	for vert in verts:
-#		uvs.append(Vector2(vert.y, 0))
-
-	arr[Mesh.ARRAY_VERTEX] = verts
-#	arr[Mesh.ARRAY_TEX_UV] = uvs
+	var arr = pointcloud.get_pointcloud_arrays("map")
+	var verts = arr[Mesh.ARRAY_VERTEX]
 
 	if sum_time * transparency_speed < 2 * PI:
 		transparency = (cos(sum_time * transparency_speed) + 1.0) * 0.5
@@ -33,7 +26,7 @@ func _process(delta):
 		sum_time = 0.0
 
 
-	if !verts.is_empty():
+	if verts != null and !verts.is_empty():
 		mesh.clear_surfaces()
 		mesh.add_surface_from_arrays(Mesh.PRIMITIVE_POINTS, arr)
 	pointcloud.set_old()
@@ -1,12 +1,38 @@
 extends MeshInstance3D
 
 var pointcloud = PointCloud.new()
+var pointcloud_map = PointCloudMap.new()
+var ego_pose = EgoPose.new()
 var visualize_again = false
+# Voxel grid leaf size in meters (0: disabled)
+@export var voxel_size: float = 0.0
+# Maximum number of points to draw (0: unlimited)
+@export var max_points: int = 0
+# Split the map into tiles and draw them with distance-based LOD
+@export var use_tiles: bool = true
+# Interval in seconds between LOD updates
+@export var lod_update_interval: float = 0.5
+# Keep the converted map under user:// to skip the conversion on the next launch
+@export var disk_cache: bool = true
+# Tile key -> {"node": MeshInstance3D, "lod": int}
+var tile_meshes = {}
+var lod_update_timer = 0.0
 
 func _ready():
+	if use_tiles:
+		pointcloud_map.disk_cache = disk_cache
+		pointcloud_map.subscribe("/map/pointcloud_map", true)
+		return
+	pointcloud.voxel_size = voxel_size
+	pointcloud.max_points = max_points
+	pointcloud.disk_cache = disk_cache
+	pointcloud.enable_precompute("map")
 	pointcloud.subscribe("/map/pointcloud_map", true)
 
-func _process(_delta):
+func _process(delta):
+	if use_tiles:
+		update_tiles(delta)
+		return
 	if not (pointcloud.has_new() or visualize_again):
 		return
 	var arr = []
@@ -25,10 +51,54 @@ func _process(_delta):
 	visualize_again = false
 	pointcloud.set_old()
 
+func update_tiles(delta):
+	if not visible:
+		return
+	lod_update_timer -= delta
+	if not (pointcloud_map.has_new() or visualize_again or lod_update_timer <= 0.0):
+		return
+	lod_update_timer = lod_update_interval
+	if pointcloud_map.has_new():
+		clear_tiles()
+
+	var visible_keys = {}
+	for tile in pointcloud_map.get_tiles(ego_pose.get_ego_position()):
+		var key = tile["key"]
+		visible_keys[key] = true
+		if tile_meshes.has(key) and tile_meshes[key]["lod"] == tile["lod"]:
+			continue
+		if not tile_meshes.has(key):
+			var tile_mesh = MeshInstance3D.new()
+			tile_mesh.mesh = ArrayMesh.new()
+			tile_mesh.material_override = material_override
+			add_child(tile_mesh)
+			tile_meshes[key] = {"node": tile_mesh, "lod": -1}
+		var arr = []
+		arr.resize(Mesh.ARRAY_MAX)
+		arr[Mesh.ARRAY_VERTEX] = tile["points"]
+		var tile_mesh = tile_meshes[key]["node"]
+		tile_mesh.mesh.clear_surfaces()
+		tile_mesh.mesh.add_surface_from_arrays(Mesh.PRIMITIVE_POINTS, arr)
+		tile_meshes[key]["lod"] = tile["lod"]
+
+	# Drop the tiles that moved out of range
+	for key in tile_meshes.keys():
+		if not visible_keys.has(key):
+			tile_meshes[key]["node"].queue_free()
+			tile_meshes.erase(key)
+	visualize_again = false
+	pointcloud_map.set_old()
+
+func clear_tiles():
+	for key in tile_meshes:
+		tile_meshes[key]["node"].queue_free()
+	tile_meshes.clear()
+
 func _on_CheckButton_toggled(button_pressed):
 
 	visible = button_pressed
 	if not visible:
 		mesh.clear_surfaces()
+		clear_tiles()
 	elif visible:
 		visualize_again = true
@@ -1,18 +1,40 @@
 extends MeshInstance3D
 
-func visualize_mesh(triangle_list):
+# One MeshInstance3D per map tile, so the tiles outside the view frustum are culled
+var tile_instances = []
+
+func visualize_mesh(arr):
 	mesh.clear_surfaces()
 
-	var arr = []
-	arr.resize(Mesh.ARRAY_MAX)
-	var verts = PackedVector3Array()
+	var verts = arr[Mesh.ARRAY_VERTEX]
+	if verts == null or verts.is_empty():
+		return
+	set_flat_normals(arr)
+	mesh.add_surface_from_arrays(Mesh.PRIMITIVE_TRIANGLES, arr)
+
+# Draws MarkerArray.get_tiled_triangle_list_arrays. Tiles farther than visibility_range are hidden,
+# 0 draws every tile.
+func visualize_tiles(tiles, visibility_range = 0.0):
+	mesh.clear_surfaces()
+	for tile_instance in tile_instances:
+		tile_instance.queue_free()
+	tile_instances.clear()
+
+	for tile in tiles:
+		var arr = tile["arrays"]
+		set_flat_normals(arr)
+		var tile_mesh = ArrayMesh.new()
+		tile_mesh.add_surface_from_arrays(Mesh.PRIMITIVE_TRIANGLES, arr)
+		var tile_instance = MeshInstance3D.new()
+		tile_instance.mesh = tile_mesh
+		tile_instance.material_override = material_override
+		tile_instance.visibility_range_end = visibility_range
+		add_child(tile_instance)
+		tile_instances.append(tile_instance)
+
+# The surfaces are lit as if they were flat
+func set_flat_normals(arr):
 	var normals = PackedVector3Array()
-#	var colors = PoolColorArray()
-	
-	for point in triangle_list:
-		verts.append(point["position"])
-		normals.append(Vector3(0,1,0))
-			
-	arr[Mesh.ARRAY_VERTEX] = verts
+	normals.resize(arr[Mesh.ARRAY_VERTEX].size())
+	normals.fill(Vector3(0,1,0))
 	arr[Mesh.ARRAY_NORMAL] = normals
-	mesh.add_surface_from_arrays(Mesh.PRIMITIVE_TRIANGLES, arr)
@@ -1,7 +1,30 @@
 extends MeshInstance3D
 
-func visualize_mesh(board_triangle_list, traffic_lights):
-	mesh.clear_surfaces()
+var mesh_builder = MeshBuilder.new()
+# Instances of a unit sphere, one per traffic light bulb
+var light_multimesh = MultiMesh.new()
+const rgb_scale = 0.05
+
+func _ready():
+	mesh_builder.attach(self)
+	var sphere_mesh = SphereMesh.new()
+	sphere_mesh.radius = 0.5
+	sphere_mesh.height = 1.0
+	sphere_mesh.radial_segments = 8
+	sphere_mesh.rings = 4
+	light_multimesh.mesh = sphere_mesh
+	var light_instance = MultiMeshInstance3D.new()
+	light_instance.multimesh = light_multimesh
+	# Unlit bulbs are drawn dimmed
+	var light_material = material_override.duplicate()
+	light_material.albedo_color = Color(rgb_scale, rgb_scale, rgb_scale, 1.0)
+	light_instance.material_override = light_material
+	add_child(light_instance)
+
+func visualize_lights(markers, ns):
+	markers.update_multimesh(ns, light_multimesh, null)
+
+func visualize_mesh(board_arr):
 
 	# Traffic Board
 	var boards_arr = []
@@ -10,58 +33,33 @@ func visualize_mesh(board_triangle_list, traffic_lights):
 	var boards_normals = PackedVector3Array()
 	var boards_colors = PackedColorArray()
 
-	# back board
-	for point in board_triangle_list:
-		boards_verts.append(point["position"])
-		boards_normals.append(point["normal"])
-		boards_colors.append(Color(0.1, 0.1, 0.1, 1.0))
+	var board_verts = board_arr[Mesh.ARRAY_VERTEX]
+	var board_normals = board_arr[Mesh.ARRAY_NORMAL]
+	if board_verts != null:
+		var board_size = board_verts.size()
+		# back board
+		boards_verts.append_array(board_verts)
+		boards_normals.append_array(board_normals)
+		boards_colors.resize(board_size)
+		boards_colors.fill(Color(0.1, 0.1, 0.1, 1.0))
 
-	# front board
-	for i in board_triangle_list.size():
-		if(i % 3 ==2):
-			boards_verts.append(board_triangle_list[i]["position"])
-			boards_verts.append(board_triangle_list[i-1]["position"])
-			boards_verts.append(board_triangle_list[i-2]["position"])
-			boards_normals.append(-1.0*board_triangle_list[i]["normal"])
-			boards_normals.append(boards_normals[boards_normals.size()-1])
-			boards_normals.append(boards_normals[boards_normals.size()-1])
-		boards_colors.append(Color(0.5, 0.5, 0.5, 1.0))
+		# front board
+		for i in range(2, board_size, 3):
+			boards_verts.append(board_verts[i])
+			boards_verts.append(board_verts[i-1])
+			boards_verts.append(board_verts[i-2])
+			var front_normal = -1.0 * board_normals[i]
+			boards_normals.append(front_normal)
+			boards_normals.append(front_normal)
+			boards_normals.append(front_normal)
+		var front_colors = PackedColorArray()
+		front_colors.resize(board_size - board_size % 3)
+		front_colors.fill(Color(0.5, 0.5, 0.5, 1.0))
+		boards_colors.append_array(front_colors)
 
 	boards_arr[Mesh.ARRAY_VERTEX] = boards_verts
 	boards_arr[Mesh.ARRAY_NORMAL] = boards_normals
 	boards_arr[Mesh.ARRAY_COLOR] = boards_colors
 
-	# Traffic Light
-	var spheres_arr = []
-	var sphere_verts = PackedVector3Array()
-	var sphere_normals = PackedVector3Array()
-	var sphere_indices = PackedInt32Array()
-	var sphere_colors = PackedColorArray()
-	spheres_arr.resize(Mesh.ARRAY_MAX)
-
-	var index_offset = 0
-	var rgb_scale = 0.05
-	for traffic_light in traffic_lights:
-		var sphere_mesh = SphereMesh.new()
-		sphere_mesh.set_height(traffic_light[3].x)
-		sphere_mesh.set_radius(traffic_light[3].x * 0.5)
-		sphere_mesh.set_radial_segments(8)
-		sphere_mesh.set_rings(4)
-
-		var sphere_arr = sphere_mesh.get_mesh_arrays()
-		for sphere_vert in sphere_arr[Mesh.ARRAY_VERTEX]: 
-			sphere_verts.append(sphere_vert + Vector3(traffic_light[1].x, traffic_light[1].y, traffic_light[1].z))
-			sphere_colors.append(Color(traffic_light[0].r * rgb_scale, traffic_light[0].g * rgb_scale, traffic_light[0].b * rgb_scale, 1.0))
-		for sphere_normal in sphere_arr[Mesh.ARRAY_NORMAL]: 
-			sphere_normals.append(sphere_normal)
-		for sphere_index in sphere_arr[Mesh.ARRAY_INDEX]: 
-			sphere_indices.append(sphere_index+index_offset)
-		index_offset += sphere_arr[Mesh.ARRAY_VERTEX].size()
-	spheres_arr[Mesh.ARRAY_VERTEX] = sphere_verts
-	spheres_arr[Mesh.ARRAY_NORMAL] = sphere_normals
-	spheres_arr[Mesh.ARRAY_INDEX] = sphere_indices
-	spheres_arr[Mesh.ARRAY_COLOR] = sphere_colors
-	
 	# visualize
-	mesh.add_surface_from_arrays(Mesh.PRIMITIVE_TRIANGLES, spheres_arr)
-	mesh.add_surface_from_arrays(Mesh.PRIMITIVE_TRIANGLES, boards_arr)
+	mesh_builder.update_surface(0, Mesh.PRIMITIVE_TRIANGLES, boards_arr)
@@ -1,35 +1,40 @@
 extends Node3D
 
+const road_surface_namespaces = ["road_lanelets", "shoulder_road_lanelets", "intersection_area", "parking_lots"]
+const road_marker_namespaces = ["right_lane_bound", "left_lane_bound", "shoulder_right_lane_bound", "shoulder_left_lane_bound", "pedestrian_marking", "stop_lines"]
+const traffic_light_namespace = "traffic_light_triangle"
+
 var vector_map = MarkerArray.new()
+# Keep the triangulated map under user:// to skip the triangulation on the next launch
+@export var disk_cache: bool = true
+# Split the road surface and markers into square tiles of this size in meters, so the tiles
+# outside the view are culled. 0 draws each of them as one surface.
+@export var tile_size: float = 100.0
+# Hide road marker tiles farther than this many meters, 0 draws every tile
+@export var marker_visibility_range: float = 0.0
 func _ready():
+	vector_map.disk_cache = disk_cache
+	vector_map.enable_precompute(PackedStringArray(road_surface_namespaces + road_marker_namespaces + [traffic_light_namespace]))
 	vector_map.subscribe("/map/vector_map_marker", true)
 
 
 func _process(_delta):
 	if !vector_map.has_new():
 		return
-	# Road Surface
 	var road_surface = get_node("RoadSurfaceMesh")
-	var road_surface_triangle_list = Array()
-	road_surface_triangle_list.append_array(vector_map.get_triangle_list("road_lanelets"))
-	road_surface_triangle_list.append_array(vector_map.get_triangle_list("shoulder_road_lanelets"))
-	road_surface_triangle_list.append_array(vector_map.get_triangle_list("intersection_area"))
-	road_surface_triangle_list.append_array(vector_map.get_triangle_list("parking_lots"))
-	road_surface.visualize_mesh(road_surface_triangle_list)
-	# Road Marker
 	var road_marker = get_node("RoadMarkerMesh")
-	var road_marker_verts = Array()
-	road_marker_verts.append_array(vector_map.get_triangle_list("right_lane_bound"))
-	road_marker_verts.append_array(vector_map.get_triangle_list("left_lane_bound"))
-	road_marker_verts.append_array(vector_map.get_triangle_list("shoulder_right_lane_bound"))
-	road_marker_verts.append_array(vector_map.get_triangle_list("shoulder_left_lane_bound"))
-	road_marker_verts.append_array(vector_map.get_triangle_list("pedestrian_marking"))
-	road_marker_verts.append_array(vector_map.get_triangle_list("stop_lines"))
-	road_marker.visualize_mesh(road_marker_verts)
+	if tile_size > 0.0:
+		road_surface.visualize_tiles(vector_map.get_tiled_triangle_list_arrays(PackedStringArray(road_surface_namespaces), tile_size))
+		road_marker.visualize_tiles(vector_map.get_tiled_triangle_list_arrays(PackedStringArray(road_marker_namespaces), tile_size), marker_visibility_range)
+	else:
+		# Road Surface
+		road_surface.visualize_mesh(vector_map.get_merged_triangle_list_arrays(PackedStringArray(road_surface_namespaces)))
+		# Road Marker
+		road_marker.visualize_mesh(vector_map.get_merged_triangle_list_arrays(PackedStringArray(road_marker_namespaces)))
 	# Traffic Light
 	var traffic_light = get_node("TrafficLightMesh")
-	traffic_light.visualize_mesh(vector_map.get_triangle_list("traffic_light_triangle"), vector_map.get_color_spheres("traffic_light"))
+	traffic_light.visualize_mesh(vector_map.get_triangle_list_arrays(traffic_light_namespace))
+	traffic_light.visualize_lights(vector_map, "traffic_light")
 
 	vector_map.set_old()
 
-
@@ -0,0 +1,33 @@
+extends SceneTree
+
+# Runs the conversion benchmarks and prints the results as JSON, one line per run:
+#   godot --headless --path godot-project --script res://benchmark/Benchmark.gd
+#   godot --headless --path godot-project --script res://benchmark/Benchmark.gd -- --bag=<path>
+# Requires an engine built with `scons godot_rviz2_benchmark=yes`.
+
+func _initialize():
+	if not ClassDB.class_exists("GodotRviz2Benchmark"):
+		printerr("GodotRviz2Benchmark is missing, build with godot_rviz2_benchmark=yes")
+		quit(1)
+		return
+
+	var bag_path = ""
+	var iterations = 10
+	for arg in OS.get_cmdline_user_args():
+		if arg.begins_with("--bag="):
+			bag_path = arg.trim_prefix("--bag=")
+		elif arg.begins_with("--iterations="):
+			iterations = arg.trim_prefix("--iterations=").to_int()
+
+	var benchmark = ClassDB.instantiate("GodotRviz2Benchmark")
+	if bag_path.is_empty():
+		report("pointcloud", benchmark.run_pointcloud(1000000, iterations))
+		report("marker_array", benchmark.run_marker_array(50000, iterations))
+		report("dynamic_objects", benchmark.run_dynamic_objects(500, iterations * 10))
+		report("trajectory", benchmark.run_trajectory(1000, iterations * 10))
+	else:
+		report("rosbag", benchmark.run_rosbag(bag_path, iterations))
+	quit()
+
+func report(name, result):
+	print(JSON.stringify({"benchmark": name, "result": result}))
@@ -0,0 +1,72 @@
+//
+//  Copyright 2022 Yukihiro Saito. All rights reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#include "allocation_counter.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+std::atomic<uint64_t> allocation_count{0};
+
+void count_allocation() { allocation_count.fetch_add(1, std::memory_order_relaxed); }
+}  // namespace
+
+uint64_t get_allocation_count() { return allocation_count.load(std::memory_order_relaxed); }
+
+// The linker redirects malloc, calloc and realloc to the __wrap_ functions and the originals to
+// the __real_ ones
+extern "C" {
+void * __real_malloc(size_t size);
+void * __real_calloc(size_t count, size_t size);
+void * __real_realloc(void * ptr, size_t size);
+
+void * __wrap_malloc(size_t size)
+{
+  count_allocation();
+  return __real_malloc(size);
+}
+
+void * __wrap_calloc(size_t count, size_t size)
+{
+  count_allocation();
+  return __real_calloc(count, size);
+}
+
+void * __wrap_realloc(void * ptr, size_t size)
+{
+  count_allocation();
+  return __real_realloc(ptr, size);
+}
+}
+
+// libstdc++ calls malloc from its own library, where --wrap does not apply, so the global operator
+// new is replaced as well
+void * operator new(size_t size)
+{
+  count_allocation();
+  void * ptr = __real_malloc(size > 0 ? size : 1);
+  if (!ptr) throw std::bad_alloc();
+  return ptr;
+}
+
+void * operator new[](size_t size) { return operator new(size); }
+void operator delete(void * ptr) noexcept { std::free(ptr); }
+void operator delete[](void * ptr) noexcept { std::free(ptr); }
+void operator delete(void * ptr, size_t) noexcept { std::free(ptr); }
+void operator delete[](void * ptr, size_t) noexcept { std::free(ptr); }
@@ -0,0 +1,28 @@
+//
+//  Copyright 2022 Yukihiro Saito. All rights reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#pragma once
+
+#include <cstdint>
+
+/**
+ * @brief Gets the number of heap allocations made by the process so far.
+ *
+ * Counts malloc, calloc and realloc, which Godot's Memory::alloc_static goes through, as well as
+ * the global operator new. Requires the -Wl,--wrap flags SCsub adds with godot_rviz2_benchmark=yes.
+ * Allocations on every thread are counted, including the WorkerThreadPool tasks of a conversion.
+ */
+uint64_t get_allocation_count();
@@ -0,0 +1,449 @@
+//
+//  Copyright 2022 Yukihiro Saito. All rights reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#include "conversion_benchmark.hpp"
+
+#include "allocation_counter.hpp"
+#include "dynamic_objects.hpp"
+#include "marker_array.hpp"
+#include "pointcloud.hpp"
+#include "rclcpp/serialization.hpp"
+#include "rosbag2_cpp/reader.hpp"
+#include "scene/resources/mesh.h"
+#include "topic_stats.hpp"
+#include "trajectory.hpp"
+#include "util.hpp"
+
+#include "sensor_msgs/msg/point_field.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+using PredictedObjects = autoware_auto_perception_msgs::msg::PredictedObjects;
+using SerializedBagMessages = std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>>;
+
+/**
+ * @brief Times a getter, delivering a fresh copy of the next message before every call.
+ *
+ * The copy defeats the per-message caches of the getters. Copying and delivering are not timed.
+ *
+ * @param messages Messages to cycle through.
+ * @param iterations Number of calls.
+ * @param unit Name of what call counts, e.g. "points".
+ * @param subscriber The subscriber the messages are delivered to.
+ * @param call Calls the getter with the delivered message and returns the number of units.
+ * @return Dictionary The run result, see GodotRviz2Benchmark.
+ */
+template <class MsgT, class SubscriberT, class Call>
+Dictionary measure(
+  const std::vector<std::shared_ptr<const MsgT>> & messages, const int iterations,
+  const String & unit, const Ref<SubscriberT> & subscriber, Call && call)
+{
+  Dictionary result;
+  if (messages.empty() || iterations <= 0) return result;
+
+  LatencyHistogram durations;
+  double total_seconds = 0.0;
+  double total_units = 0.0;
+  uint64_t total_allocations = 0;
+  for (int i = 0; i < iterations; ++i) {
+    const auto msg = std::make_shared<const MsgT>(*messages[i % messages.size()]);
+    subscriber->receive_message(msg);
+
+    const uint64_t allocations = get_allocation_count();
+    const auto start = std::chrono::steady_clock::now();
+    const size_t units = call(*msg);
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    total_allocations += get_allocation_count() - allocations;
+
+    durations.record(elapsed.count());
+    total_seconds += elapsed.count();
+    total_units += units;
+  }
+
+  result["calls"] = iterations;
+  result["mean"] = durations.get_mean();
+  result["p50"] = durations.get_percentile(0.5);
+  result["p99"] = durations.get_percentile(0.99);
+  result[unit + "_per_call"] = total_units / iterations;
+  result[unit + "_per_second"] = total_seconds > 0.0 ? total_units / total_seconds : 0.0;
+  result["allocations_per_call"] = static_cast<double>(total_allocations) / iterations;
+  return result;
+}
+
+/**
+ * @brief Counts the triangles of a triangle list in the Array format of MeshArrays::to_array.
+ */
+size_t count_list_triangles(const Array & arrays)
+{
+  if (arrays.size() != Mesh::ARRAY_MAX) return 0;
+  const PackedInt32Array indices = arrays[Mesh::ARRAY_INDEX];
+  if (!indices.is_empty()) return indices.size() / 3;
+  const PackedVector3Array vertices = arrays[Mesh::ARRAY_VERTEX];
+  return vertices.size() / 3;
+}
+
+/**
+ * @brief Counts the triangles of a triangle strip with the given number of vertices.
+ */
+size_t count_strip_triangles(const int64_t num_vertices)
+{
+  return num_vertices > 2 ? num_vertices - 2 : 0;
+}
+
+Dictionary benchmark_pointclouds(
+  const std::vector<std::shared_ptr<const sensor_msgs::msg::PointCloud2>> & messages,
+  const int iterations)
+{
+  Ref<PointCloud> pointcloud;
+  pointcloud.instantiate();
+  Dictionary results;
+  // Convert in the frame of the message, so no transform is needed
+  results["get_pointcloud"] = measure(
+    messages, iterations, "points", pointcloud, [&](const sensor_msgs::msg::PointCloud2 & msg) {
+      return pointcloud->get_pointcloud(String(msg.header.frame_id.c_str())).size();
+    });
+  return results;
+}
+
+Dictionary benchmark_marker_arrays(
+  const std::vector<std::shared_ptr<const visualization_msgs::msg::MarkerArray>> & messages,
+  const int iterations)
+{
+  Ref<MarkerArray> marker_array;
+  marker_array.instantiate();
+  const auto get_ns = [](const visualization_msgs::msg::MarkerArray & msg) {
+    return msg.markers.empty() ? String() : String(msg.markers.front().ns.c_str());
+  };
+  Dictionary results;
+  results["get_triangle_list_arrays"] = measure(
+    messages, iterations, "triangles", marker_array,
+    [&](const visualization_msgs::msg::MarkerArray & msg) {
+      return count_list_triangles(marker_array->get_triangle_list_arrays(get_ns(msg)));
+    });
+  results["get_triangle_list"] = measure(
+    messages, iterations, "triangles", marker_array,
+    [&](const visualization_msgs::msg::MarkerArray & msg) {
+      return static_cast<size_t>(marker_array->get_triangle_list(get_ns(msg)).size() / 3);
+    });
+  return results;
+}
+
+Dictionary benchmark_dynamic_objects(
+  const std::vector<std::shared_ptr<const PredictedObjects>> & messages, const int iterations)
+{
+  Ref<DynamicObjects> dynamic_objects;
+  dynamic_objects.instantiate();
+  Dictionary results;
+  results["get_triangle_list_arrays"] = measure(
+    messages, iterations, "triangles", dynamic_objects, [&](const PredictedObjects &) {
+      return count_list_triangles(dynamic_objects->get_triangle_list_arrays(false));
+    });
+  results["get_triangle_list"] = measure(
+    messages, iterations, "triangles", dynamic_objects, [&](const PredictedObjects &) {
+      return static_cast<size_t>(dynamic_objects->get_triangle_list(false).size() / 3);
+    });
+  results["get_instances"] = measure(
+    messages, iterations, "objects", dynamic_objects, [&](const PredictedObjects & msg) {
+      dynamic_objects->get_instances(false);
+      return msg.objects.size();
+    });
+  return results;
+}
+
+Dictionary benchmark_trajectories(
+  const std::vector<std::shared_ptr<const autoware_auto_planning_msgs::msg::Trajectory>> & messages,
+  const int iterations)
+{
+  constexpr float width = 2.0;
+  Ref<Trajectory> trajectory;
+  trajectory.instantiate();
+  Dictionary results;
+  results["get_trajectory_triangle_strip_arrays"] = measure(
+    messages, iterations, "triangles", trajectory,
+    [&](const autoware_auto_planning_msgs::msg::Trajectory &) {
+      const Array arrays = trajectory->get_trajectory_triangle_strip_arrays(width);
+      const PackedVector3Array vertices = arrays[Mesh::ARRAY_VERTEX];
+      return count_strip_triangles(vertices.size());
+    });
+  results["get_trajectory_triangle_strip"] = measure(
+    messages, iterations, "triangles", trajectory,
+    [&](const autoware_auto_planning_msgs::msg::Trajectory &) {
+      return count_strip_triangles(trajectory->get_trajectory_triangle_strip(width).size());
+    });
+  return results;
+}
+
+std::shared_ptr<const sensor_msgs::msg::PointCloud2> make_pointcloud(const int num_points)
+{
+  auto msg = std::make_shared<sensor_msgs::msg::PointCloud2>();
+  msg->header.frame_id = "map";
+  msg->height = 1;
+  msg->width = std::max(num_points, 0);
+  msg->is_dense = true;
+  const char * names[] = {"x", "y", "z", "intensity"};
+  for (uint32_t i = 0; i < 4; ++i) {
+    sensor_msgs::msg::PointField field;
+    field.name = names[i];
+    field.offset = i * sizeof(float);
+    field.datatype = sensor_msgs::msg::PointField::FLOAT32;
+    field.count = 1;
+    msg->fields.push_back(field);
+  }
+  msg->point_step = 4 * sizeof(float);
+  msg->row_step = msg->width * msg->point_step;
+  msg->data.resize(static_cast<size_t>(msg->row_step));
+
+  // Points scattered over a 200 m x 200 m x 10 m volume around the origin
+  std::mt19937 random(42);
+  std::uniform_real_distribution<float> horizontal(-100.0f, 100.0f);
+  std::uniform_real_distribution<float> vertical(0.0f, 10.0f);
+  for (uint32_t i = 0; i < msg->width; ++i) {
+    const float point[4] = {
+      horizontal(random), horizontal(random), vertical(random), static_cast<float>(i % 256)};
+    std::memcpy(msg->data.data() + i * msg->point_step, point, sizeof(point));
+  }
+  return msg;
+}
+
+std::shared_ptr<const visualization_msgs::msg::MarkerArray> make_vector_map(const int num_markers)
+{
+  auto msg = std::make_shared<visualization_msgs::msg::MarkerArray>();
+  msg->markers.resize(std::max(num_markers, 0));
+  // Quads of 4 m x 4 m road surface on a grid, two triangles each
+  const int columns = std::max(static_cast<int>(std::sqrt(num_markers)), 1);
+  for (int i = 0; i < num_markers; ++i) {
+    auto & marker = msg->markers[i];
+    marker.header.frame_id = "map";
+    marker.ns = "road_surface";
+    marker.id = i;
+    marker.type = visualization_msgs::msg::Marker::TRIANGLE_LIST;
+    marker.action = visualization_msgs::msg::Marker::ADD;
+    marker.pose.orientation.w = 1.0;
+    marker.scale.x = marker.scale.y = marker.scale.z = 1.0;
+    marker.color.r = marker.color.g = marker.color.b = 0.5;
+    marker.color.a = 1.0;
+    const double x = (i % columns) * 4.0;
+    const double y = (i / columns) * 4.0;
+    const double corners[6][2] = {{0, 0}, {4, 0}, {4, 4}, {0, 0}, {4, 4}, {0, 4}};
+    for (const auto & corner : corners) {
+      geometry_msgs::msg::Point point;
+      point.x = x + corner[0];
+      point.y = y + corner[1];
+      marker.points.push_back(point);
+    }
+  }
+  return msg;
+}
+
+/**
+ * @brief Makes a sequence of object messages in which every object keeps its ID and shape and
+ * drives 1 m along its heading per message, as tracked objects do.
+ */
+std::vector<std::shared_ptr<const PredictedObjects>> make_dynamic_objects(
+  const int num_objects, const int num_frames)
+{
+  using autoware_auto_perception_msgs::msg::ObjectClassification;
+  using autoware_auto_perception_msgs::msg::Shape;
+
+  auto msg = std::make_shared<PredictedObjects>();
+  msg->header.frame_id = "map";
+  msg->objects.resize(std::max(num_objects, 0));
+  std::mt19937 random(42);
+  std::uniform_real_distribution<double> position(-50.0, 50.0);
+  std::uniform_real_distribution<double> yaw(-M_PI, M_PI);
+  for (int i = 0; i < num_objects; ++i) {
+    auto & object = msg->objects[i];
+    std::memcpy(object.object_id.uuid.data(), &i, sizeof(i));
+    ObjectClassification classification;
+    classification.label = ObjectClassification::CAR;
+    classification.probability = 1.0;
+    object.classification.push_back(classification);
+
+    auto & pose = object.kinematics.initial_pose_with_covariance.pose;
+    pose.position.x = position(random);
+    pose.position.y = position(random);
+    const double angle = yaw(random);
+    pose.orientation.z = std::sin(angle / 2.0);
+    pose.orientation.w = std::cos(angle / 2.0);
+
+    // One third each of boxes, cylinders and octagonal polygons. The generators only accept
+    // clockwise footprints.
+    object.shape.dimensions.x = 4.0;
+    object.shape.dimensions.y = 2.0;
+    object.shape.dimensions.z = 1.5;
+    if (i % 3 == 0) {
+      object.shape.type = Shape::BOUNDING_BOX;
+    } else if (i % 3 == 1) {
+      object.shape.type = Shape::CYLINDER;
+    } else {
+      object.shape.type = Shape::POLYGON;
+      for (int j = 0; j < 8; ++j) {
+        geometry_msgs::msg::Point32 point;
+        point.x = 2.0 * std::cos(-j * M_PI / 4.0);
+        point.y = 1.0 * std::sin(-j * M_PI / 4.0);
+        object.shape.footprint.points.push_back(point);
+      }
+    }
+  }
+
+  std::vector<std::shared_ptr<const PredictedObjects>> frames{msg};
+  for (int frame = 1; frame < num_frames; ++frame) {
+    auto moved = std::make_shared<PredictedObjects>(*frames.back());
+    for (auto & object : moved->objects) {
+      auto & pose = object.kinematics.initial_pose_with_covariance.pose;
+      const double angle = 2.0 * std::atan2(pose.orientation.z, pose.orientation.w);
+      pose.position.x += std::cos(angle);
+      pose.position.y += std::sin(angle);
+    }
+    frames.push_back(moved);
+  }
+  return frames;
+}
+
+std::shared_ptr<const autoware_auto_planning_msgs::msg::Trajectory> make_trajectory(
+  const int num_points)
+{
+  auto msg = std::make_shared<autoware_auto_planning_msgs::msg::Trajectory>();
+  msg->header.frame_id = "map";
+  msg->points.resize(std::max(num_points, 0));
+  // A 0.5 m spaced arc with a 100 m radius
+  constexpr double radius = 100.0;
+  for (int i = 0; i < num_points; ++i) {
+    const double angle = i * 0.5 / radius;
+    auto & point = msg->points[i];
+    point.pose.position.x = radius * std::sin(angle);
+    point.pose.position.y = radius * (1.0 - std::cos(angle));
+    point.pose.orientation.z = std::sin(angle / 2.0);
+    point.pose.orientation.w = std::cos(angle / 2.0);
+    point.longitudinal_velocity_mps = 10.0;
+  }
+  return msg;
+}
+
+template <class MsgT>
+std::vector<std::shared_ptr<const MsgT>> deserialize(const SerializedBagMessages & bag_messages)
+{
+  rclcpp::Serialization<MsgT> serialization;
+  std::vector<std::shared_ptr<const MsgT>> messages;
+  messages.reserve(bag_messages.size());
+  for (const auto & bag_message : bag_messages) {
+    const rclcpp::SerializedMessage serialized(*bag_message->serialized_data);
+    auto msg = std::make_shared<MsgT>();
+    serialization.deserialize_message(&serialized, msg.get());
+    messages.push_back(msg);
+  }
+  return messages;
+}
+}  // namespace
+
+void GodotRviz2Benchmark::_bind_methods()
+{
+  ClassDB::bind_method(
+    D_METHOD("run_pointcloud", "num_points", "iterations"), &GodotRviz2Benchmark::run_pointcloud,
+    DEFVAL(1000000), DEFVAL(10));
+  ClassDB::bind_method(
+    D_METHOD("run_marker_array", "num_markers", "iterations"),
+    &GodotRviz2Benchmark::run_marker_array, DEFVAL(50000), DEFVAL(10));
+  ClassDB::bind_method(
+    D_METHOD("run_dynamic_objects", "num_objects", "iterations"),
+    &GodotRviz2Benchmark::run_dynamic_objects, DEFVAL(500), DEFVAL(100));
+  ClassDB::bind_method(
+    D_METHOD("run_trajectory", "num_points", "iterations"), &GodotRviz2Benchmark::run_trajectory,
+    DEFVAL(1000), DEFVAL(100));
+  ClassDB::bind_method(
+    D_METHOD("run_rosbag", "path", "iterations"), &GodotRviz2Benchmark::run_rosbag, DEFVAL(10));
+}
+
+Dictionary GodotRviz2Benchmark::run_pointcloud(const int num_points, const int iterations)
+{
+  return benchmark_pointclouds({make_pointcloud(num_points)}, iterations);
+}
+
+Dictionary GodotRviz2Benchmark::run_marker_array(const int num_markers, const int iterations)
+{
+  return benchmark_marker_arrays({make_vector_map(num_markers)}, iterations);
+}
+
+Dictionary GodotRviz2Benchmark::run_dynamic_objects(const int num_objects, const int iterations)
+{
+  return benchmark_dynamic_objects(make_dynamic_objects(num_objects, 10), iterations);
+}
+
+Dictionary GodotRviz2Benchmark::run_trajectory(const int num_points, const int iterations)
+{
+  return benchmark_trajectories({make_trajectory(num_points)}, iterations);
+}
+
+Dictionary GodotRviz2Benchmark::run_rosbag(const String & path, const int iterations)
+{
+  // Read at most iterations messages of every supported topic
+  const std::map<std::string, std::string> supported_types = {
+    {"sensor_msgs/msg/PointCloud2", "pointcloud"},
+    {"visualization_msgs/msg/MarkerArray", "marker_array"},
+    {"autoware_auto_perception_msgs/msg/PredictedObjects", "dynamic_objects"},
+    {"autoware_auto_planning_msgs/msg/Trajectory", "trajectory"}};
+  std::map<std::string, std::string> topic_types;
+  std::map<std::string, SerializedBagMessages> bag_messages;
+  try {
+    rosbag2_cpp::Reader reader;
+    reader.open(to_std(path));
+    for (const auto & topic : reader.get_all_topics_and_types()) {
+      const auto it = supported_types.find(topic.type);
+      if (it != supported_types.end()) topic_types[topic.name] = it->second;
+    }
+    while (reader.has_next()) {
+      const auto bag_message = reader.read_next();
+      if (!topic_types.count(bag_message->topic_name)) continue;
+      auto & messages = bag_messages[bag_message->topic_name];
+      if (messages.size() < static_cast<size_t>(std::max(iterations, 0))) {
+        messages.push_back(bag_message);
+      }
+    }
+  } catch (const std::exception & ex) {
+    RCLCPP_WARN(
+      rclcpp::get_logger("godot_rviz2"), "Failed to read %s: %s", to_std(path).c_str(), ex.what());
+    return Dictionary();
+  }
+
+  Dictionary results;
+  for (const auto & [topic, messages] : bag_messages) {
+    const std::string & type = topic_types[topic];
+    Dictionary result;
+    if (type == "pointcloud") {
+      result = benchmark_pointclouds(
+        deserialize<sensor_msgs::msg::PointCloud2>(messages), iterations);
+    } else if (type == "marker_array") {
+      result = benchmark_marker_arrays(
+        deserialize<visualization_msgs::msg::MarkerArray>(messages), iterations);
+    } else if (type == "dynamic_objects") {
+      result = benchmark_dynamic_objects(deserialize<PredictedObjects>(messages), iterations);
+    } else if (type == "trajectory") {
+      result = benchmark_trajectories(
+        deserialize<autoware_auto_planning_msgs::msg::Trajectory>(messages), iterations);
+    }
+    results[String(topic.c_str())] = result;
+  }
+  return results;
+}
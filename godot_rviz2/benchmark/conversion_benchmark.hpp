@@ -0,0 +1,90 @@
+//
+//  Copyright 2022 Yukihiro Saito. All rights reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#pragma once
+
+#include "core/object/ref_counted.h"
+#include "core/string/ustring.h"
+#include "core/variant/variant.h"
+
+/**
+ * @class GodotRviz2Benchmark
+ * @brief The GodotRviz2Benchmark class measures the conversion getters without a ROS 2 stack.
+ *
+ * Synthetic or recorded messages are handed to the subscribers with receive_message, as if they
+ * had arrived on a topic, and the getters GDScript calls are timed. Each run returns a Dictionary
+ * with one entry per getter holding the number of calls, the mean, p50 and p99 duration in
+ * seconds, the throughput in points/s or triangles/s and the heap allocations per call.
+ *
+ * Only built with `scons godot_rviz2_benchmark=yes`, see godot-project/benchmark/Benchmark.gd.
+ */
+class GodotRviz2Benchmark : public RefCounted
+{
+  GDCLASS(GodotRviz2Benchmark, RefCounted);
+
+public:
+  /**
+   * @brief Converts a cloud of x, y, z and intensity float32 points with PointCloud.
+   *
+   * @param num_points Number of points.
+   * @param iterations Number of messages converted.
+   */
+  Dictionary run_pointcloud(const int num_points = 1000000, const int iterations = 10);
+
+  /**
+   * @brief Triangulates a vector map of TRIANGLE_LIST quads with MarkerArray.
+   *
+   * @param num_markers Number of markers, all in one namespace.
+   * @param iterations Number of messages converted, each replacing every marker.
+   */
+  Dictionary run_marker_array(const int num_markers = 50000, const int iterations = 10);
+
+  /**
+   * @brief Triangulates boxes, cylinders and polygons with DynamicObjects.
+   *
+   * Cycles through 10 messages of the same objects moving along their heading.
+   *
+   * @param num_objects Number of objects, one third of each shape.
+   * @param iterations Number of messages converted.
+   */
+  Dictionary run_dynamic_objects(const int num_objects = 500, const int iterations = 100);
+
+  /**
+   * @brief Builds the triangle strip of a curved trajectory with Trajectory.
+   *
+   * @param num_points Number of trajectory points.
+   * @param iterations Number of messages converted.
+   */
+  Dictionary run_trajectory(const int num_points = 1000, const int iterations = 100);
+
+  /**
+   * @brief Replays the supported messages of a rosbag through the same getters.
+   *
+   * PointCloud2, MarkerArray, PredictedObjects and Trajectory topics are benchmarked, cycling
+   * through their recorded messages.
+   *
+   * @param path Path of the bag directory.
+   * @param iterations Number of messages converted per topic.
+   * @return Dictionary One run result per topic, keyed by topic name.
+   */
+  Dictionary run_rosbag(const String & path, const int iterations = 10);
+
+protected:
+  /**
+   * @brief Binds methods to the Godot system.
+   */
+  static void _bind_methods();
+};
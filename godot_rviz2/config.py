@@ -1,7 +1,18 @@
-
 def can_build(env, platform):
     return True
 
 
 def configure(env):
     pass
+
+
+def get_opts(platform):
+    from SCons.Variables import BoolVariable
+
+    return [
+        BoolVariable(
+            "godot_rviz2_benchmark",
+            "Build GodotRviz2Benchmark for godot-project/benchmark/Benchmark.gd",
+            False,
+        ),
+    ]
@@ -19,10 +19,14 @@
 #include "core/object/ref_counted.h"
 #include "core/string/ustring.h"
 #include "core/variant/variant.h"
+#include "mesh_arrays.hpp"
+#include "strip_cache.hpp"
 #include "topic_subscriber.hpp"
 
 #include "autoware_auto_planning_msgs/msg/path.hpp"
 
+#include <utility>
+
 class BehaviorPath : public RefCounted
 {
   GDCLASS(BehaviorPath, RefCounted);
@@ -30,7 +34,32 @@ class BehaviorPath : public RefCounted
 
 public:
   Array get_path_triangle_strip(const float width);
-  Dictionary get_drivable_area_triangle_strip(const float width);
+
+  /**
+   * @brief Gets the drivable area bounds as triangle strips of points.
+   *
+   * @param width Width of the bound lines
+   * @param miter Whether to lengthen the offsets at corners so the lines keep their width, see
+   * rviz_core::LineStripBuilder::update
+   * @return Dictionary with the "left_line" and "right_line" points.
+   */
+  Dictionary get_drivable_area_triangle_strip(const float width, const bool miter = false);
+
+  /**
+   * @brief Gets the path triangle strip as Mesh.ARRAY_* channels for add_surface_from_arrays.
+   *
+   * The velocities are stored in ARRAY_CUSTOM0, see MeshArrays::to_array.
+   */
+  Array get_path_triangle_strip_arrays(const float width);
+
+  /**
+   * @brief Gets the drivable area bounds as Mesh.ARRAY_* channels.
+   *
+   * Takes the same parameters as get_drivable_area_triangle_strip.
+   *
+   * @return Dictionary with the "left_line" and "right_line" arrays.
+   */
+  Dictionary get_drivable_area_triangle_strip_arrays(const float width, const bool miter = false);
 
   BehaviorPath() = default;
   ~BehaviorPath() = default;
@@ -40,4 +69,21 @@ protected:
    * @brief Binds methods to the Godot system.
    */
   static void _bind_methods();
+
+private:
+  // Strips of the previous calls, regenerated only from the first changed point on
+  StripCache<rviz_core::PoseStripBuilder> path_cache_;
+  StripCache<rviz_core::LineStripBuilder> left_line_cache_;
+  StripCache<rviz_core::LineStripBuilder> right_line_cache_;
+
+  /**
+   * @brief Generates the path triangle strip of the latest message.
+   */
+  MeshArrays convert_path_triangle_strip(const float width);
+
+  /**
+   * @brief Generates the left and right drivable area bounds of the latest message.
+   */
+  std::pair<MeshArrays, MeshArrays> convert_drivable_area_triangle_strip(
+    const float width, const bool miter);
 };
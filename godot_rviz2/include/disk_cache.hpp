@@ -0,0 +1,151 @@
+//
+//  Copyright 2022 Yukihiro Saito. All rights reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#pragma once
+
+#include "core/string/ustring.h"
+#include "core/variant/variant.h"
+
+#include <rclcpp/serialization.hpp>
+#include <rclcpp/serialized_message.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+/**
+ * @class DiskCache
+ * @brief Stores converted Godot-ready buffers on disk, keyed by a hash of the source message.
+ *
+ * Meant for static data such as the vector map and the point cloud map, which are received again
+ * on every launch but rarely change between sessions. Values are written with Godot's Variant
+ * encoding, so packed arrays are read back with a single bulk copy. Files live under
+ * user://godot_rviz2_cache/<name> and are written atomically through a temporary file. Safe to
+ * use from any thread.
+ *
+ * Each cache keeps at most max_entries files of up to max_bytes in total. Every store evicts the
+ * least recently written files of its directory beyond that, since a new map or a changed
+ * conversion parameter changes the key and would otherwise leave the old file behind.
+ */
+class DiskCache
+{
+public:
+  /**
+   * @param name Name of the cache directory, unique per converted data type.
+   */
+  explicit DiskCache(const String & name) : name_(name) {}
+
+  // Enough for every namespace of a vector map, which are cached separately
+  static constexpr int max_entries = 32;
+  static constexpr uint64_t max_bytes = 2ULL << 30;  // 2 GiB
+
+  /**
+   * @brief Enables or disables the cache. Disabled caches never touch the disk.
+   */
+  void set_enabled(const bool enabled) { enabled_.store(enabled); }
+  bool is_enabled() const { return enabled_.load(); }
+
+  /**
+   * @brief Loads a cached value.
+   *
+   * @param key Cache key.
+   * @param r_value Receives the value on a hit.
+   * @return true if the value was found.
+   */
+  bool load(const uint64_t key, Variant & r_value) const;
+
+  /**
+   * @brief Stores a value, replacing the previous value of the key.
+   *
+   * @param key Cache key.
+   * @param value Value to store.
+   */
+  void store(const uint64_t key, const Variant & value) const;
+
+  /**
+   * @brief Loads the value of a key, or converts and stores it on a miss.
+   *
+   * Empty results are returned without being stored, since they usually mean the conversion failed.
+   *
+   * @param key Cache key.
+   * @param convert Callable returning the converted value.
+   */
+  template <class ResultT, class Convert>
+  ResultT get_or_convert(const uint64_t key, Convert && convert) const
+  {
+    Variant cached;
+    if (load(key, cached)) return cached;
+    ResultT result = std::forward<Convert>(convert)();
+    const Variant value = result;
+    if (value.booleanize()) store(key, value);
+    return result;
+  }
+
+  /**
+   * @brief Computes the 64-bit FNV-1a hash of a byte buffer.
+   *
+   * @param data The buffer.
+   * @param size Size of the buffer in bytes.
+   * @param seed Hash to continue from, e.g. the hash of a previous buffer.
+   */
+  static uint64_t hash_bytes(
+    const void * data, const size_t size, const uint64_t seed = 14695981039346656037ULL);
+
+  /**
+   * @brief Mixes a value into a hash.
+   */
+  static uint64_t hash_combine(const uint64_t seed, const uint64_t value)
+  {
+    return hash_bytes(&value, sizeof(value), seed);
+  }
+
+  /**
+   * @brief Hashes the CDR serialization of a ROS 2 message.
+   *
+   * @param msg The message.
+   */
+  template <class MsgT>
+  static uint64_t hash_message(const MsgT & msg)
+  {
+    rclcpp::Serialization<MsgT> serialization;
+    rclcpp::SerializedMessage serialized_msg;
+    serialization.serialize_message(&msg, &serialized_msg);
+    const auto & rcl_msg = serialized_msg.get_rcl_serialized_message();
+    return hash_bytes(rcl_msg.buffer, rcl_msg.buffer_length);
+  }
+
+private:
+  String name_;
+  std::atomic<bool> enabled_{false};
+
+  /**
+   * @brief Gets the directory of the cache files, which holds no files of other caches.
+   */
+  String get_dir() const;
+
+  /**
+   * @brief Gets the path of the cache file of a key.
+   */
+  String get_path(const uint64_t key) const;
+
+  /**
+   * @brief Removes the oldest files of this cache beyond max_entries and max_bytes.
+   *
+   * @param keep_path The file just written, which is never removed.
+   */
+  void evict(const String & keep_path) const;
+};
@@ -19,10 +19,44 @@
 #include "core/object/ref_counted.h"
 #include "core/string/ustring.h"
 #include "core/variant/variant.h"
+#include "instance_buffer.hpp"
+#include "mesh_arrays.hpp"
+#include "mesh_builder.hpp"
+#include "object_key.hpp"
+#include "precompute.hpp"
+#include "scene/resources/multimesh.h"
 #include "topic_subscriber.hpp"
 
 #include "autoware_auto_perception_msgs/msg/predicted_objects.hpp"
 
+#include <unordered_set>
+
+/**
+ * @brief Per-instance data of the objects drawn with one unit shape.
+ *
+ * The custom data of each instance holds the class label in its first component.
+ */
+struct ObjectInstances : InstanceBuffer
+{
+  // Class label of each instance
+  PackedInt32Array labels;
+  // Object ID of each instance, see DynamicObjects::get_removed_objects
+  PackedStringArray ids;
+};
+
+/**
+ * @brief Dynamic objects split into instanced unit shapes and CPU-extruded polygons.
+ */
+struct DynamicObjectInstances
+{
+  // Instances of a unit cube centered at the origin
+  ObjectInstances boxes;
+  // Instances of a unit cylinder along the Y axis, with a diameter and a height of 1
+  ObjectInstances cylinders;
+  // Triangle list of the POLYGON shapes
+  MeshArrays polygons;
+};
+
 class DynamicObjects : public RefCounted
 {
   GDCLASS(DynamicObjects, RefCounted);
@@ -31,9 +65,135 @@ class DynamicObjects : public RefCounted
 public:
   Array get_triangle_list(bool only_known_objects = false);
 
-  DynamicObjects() = default;
+  /**
+   * @brief Gets the triangle list as Mesh.ARRAY_* channels for add_surface_from_arrays.
+   *
+   * @param only_known_objects Whether to skip objects classified as unknown.
+   */
+  Array get_triangle_list_arrays(bool only_known_objects = false);
+
+  /**
+   * @brief Writes the triangle list into the persistent buffers of a MeshInstance3D.
+   *
+   * The first call makes the instance draw a mesh owned by this object, see MeshBuilder.
+   *
+   * @param mesh_instance The MeshInstance3D to draw the objects with.
+   * @param only_known_objects Whether to skip objects classified as unknown.
+   */
+  void update_mesh(MeshInstance3D * mesh_instance, bool only_known_objects = false);
+
+  /**
+   * @brief Builds the triangle list of every received message in the subscription callback.
+   *
+   * @param only_known_objects The parameter get_triangle_list will be called with.
+   */
+  void enable_precompute(bool only_known_objects = false);
+  void disable_precompute();
+
+  /**
+   * @brief Gets the objects as instances of unit shapes for MultiMesh rendering.
+   *
+   * BOUNDING_BOX and CYLINDER shapes become one instance each, with their dimensions as the scale
+   * of the transform. Only POLYGON shapes are extruded on the CPU.
+   *
+   * @param only_known_objects Whether to skip objects classified as unknown.
+   * @return Dictionary with "boxes" and "cylinders", each holding "buffer" (PackedFloat32Array),
+   * "labels" (PackedInt32Array), "ids" (PackedStringArray) and "count" (int), and "polygons"
+   * (Mesh.ARRAY_* channels).
+   */
+  Dictionary get_instances(bool only_known_objects = false);
+
+  /**
+   * @brief Writes the instances into MultiMeshes and the polygons into a MeshInstance3D.
+   *
+   * The MultiMeshes are set up for 3D transforms, colors and custom data. Their instance count
+   * grows to the next power of two when exceeded and the visible instance count is set to the
+   * number of objects, so the buffers are only reallocated when the number of objects grows.
+   *
+   * @param box_multimesh MultiMesh whose mesh is a unit cube.
+   * @param cylinder_multimesh MultiMesh whose mesh is a unit cylinder.
+   * @param polygon_mesh_instance MeshInstance3D drawing the POLYGON shapes, see update_mesh.
+   * @param only_known_objects Whether to skip objects classified as unknown.
+   */
+  void update_multimesh(
+    const Ref<MultiMesh> & box_multimesh, const Ref<MultiMesh> & cylinder_multimesh,
+    MeshInstance3D * polygon_mesh_instance, bool only_known_objects = false);
+
+  /**
+   * @brief Gets the instances with the objects moved to a render time.
+   *
+   * Objects found in the messages before and after the time, matched by object ID, are
+   * interpolated between them. The others are extrapolated from the message before the time with
+   * their twist, for up to 0.5 s. Only the latest message is used unless history_size is set.
+   *
+   * @param time The render time in seconds, in the ROS clock, see get_ros_time.
+   * @param only_known_objects Whether to skip objects classified as unknown.
+   * @return Dictionary in the format of get_instances.
+   */
+  Dictionary get_instances_at(const double time, bool only_known_objects = false);
+
+  /**
+   * @brief Writes the instances moved to a render time, see get_instances_at and update_multimesh.
+   */
+  void update_multimesh_at(
+    const double time, const Ref<MultiMesh> & box_multimesh,
+    const Ref<MultiMesh> & cylinder_multimesh, MeshInstance3D * polygon_mesh_instance,
+    bool only_known_objects = false);
+
+  /**
+   * @brief Builds the instances of every received message in the subscription callback.
+   *
+   * @param only_known_objects The parameter get_instances will be called with.
+   */
+  void enable_instances_precompute(bool only_known_objects = false);
+  void disable_instances_precompute();
+
+  /**
+   * @brief Gets the objects that disappeared since the previous call.
+   *
+   * Objects are matched by object ID across the latest messages seen by each call, regardless of
+   * only_known_objects, so nodes added per object can be freed when their object is gone.
+   *
+   * @return PackedStringArray The object IDs as 32 hex digits, as in the "ids" of get_instances.
+   */
+  PackedStringArray get_removed_objects();
+
+  DynamicObjects();
   ~DynamicObjects() = default;
 
 protected:
   static void _bind_methods();
+
+private:
+  using TriangleListPrecompute =
+    Precompute<autoware_auto_perception_msgs::msg::PredictedObjects, bool, MeshArrays>;
+  std::shared_ptr<TriangleListPrecompute> precompute_;
+  using InstancesPrecompute = Precompute<
+    autoware_auto_perception_msgs::msg::PredictedObjects, bool, DynamicObjectInstances>;
+  std::shared_ptr<InstancesPrecompute> instances_precompute_;
+  Ref<MeshBuilder> mesh_builder_;
+  // Object IDs of the message seen by the last get_removed_objects call
+  std::unordered_set<ObjectKey, ObjectKeyHash> tracked_objects_;
+
+  /**
+   * @brief Gets the triangle list of the latest message, precomputed if possible.
+   */
+  MeshArrays get_latest_triangle_list(bool only_known_objects);
+
+  /**
+   * @brief Gets the instances of the latest message, precomputed if possible.
+   */
+  DynamicObjectInstances get_latest_instances(bool only_known_objects);
+
+  /**
+   * @brief Gets the instances with the objects moved to a render time, see get_instances_at.
+   */
+  DynamicObjectInstances get_instances_at_time(const double time, bool only_known_objects);
+
+  /**
+   * @brief Writes instances into MultiMeshes and the polygons into a MeshInstance3D.
+   */
+  void write_instances(
+    const DynamicObjectInstances & instances, const Ref<MultiMesh> & box_multimesh,
+    const Ref<MultiMesh> & cylinder_multimesh, MeshInstance3D * polygon_mesh_instance);
 };
@@ -46,10 +46,7 @@ public:
    */
   Vector3 get_ego_position()
   {
-    // Access the shared TF2 buffer from the singleton instance of GodotRviz2
-    const auto tf_buffer = GodotRviz2::get_instance().get_tf_buffer();
-    // Retrieve the transformation from base_link to map frame
-    const auto transform = get_transform(*tf_buffer, "base_link", "map", rclcpp::Time(0));
+    const auto transform = lookup_ego_transform();
     // Return a default Vector3 if no transformation is found
     if (!transform) return Vector3(0, 0, 0);
 
@@ -64,15 +61,68 @@ public:
    */
   Vector3 get_ego_rotation()
   {
-    // Access the shared TF2 buffer from the singleton instance of GodotRviz2
-    const auto tf_buffer = GodotRviz2::get_instance().get_tf_buffer();
-    // Retrieve the transformation from base_link to map frame
-    const auto transform = get_transform(*tf_buffer, "base_link", "map", rclcpp::Time(0));
+    const auto transform = lookup_ego_transform();
     // Return a default Vector3 if no transformation is found
     if (!transform) return Vector3(0, 0, 0);
 
-    // Extract the quaternion rotation from the transformation
-    const auto & rotation = transform.value().rotation;
+    return to_godot_rotation(transform.value().rotation);
+  }
+
+  /**
+   * @brief Retrieves the ego vehicle's position and rotation in the map frame with one lookup.
+   *
+   * @return Dictionary "position" and "rotation" as returned by get_ego_position and
+   * get_ego_rotation, and "valid", false if no transformation is found.
+   */
+  Dictionary get_ego_pose() { return to_pose_dict(lookup_ego_transform()); }
+
+  /**
+   * @brief Retrieves the ego vehicle's pose at a render time.
+   *
+   * TF2 interpolates between the transformations around the time. A time slightly after the latest
+   * transformation, up to 0.5 s, is extrapolated from the motion over the last 0.1 s. Other times
+   * get the latest pose. Rendering a little in the past, such as get_ros_time() - 0.1, keeps the
+   * ego vehicle moving smoothly between TF updates.
+   *
+   * @param time The render time in seconds, in the ROS clock.
+   * @return Dictionary in the format of get_ego_pose.
+   */
+  Dictionary get_ego_pose_at(const double time);
+
+  /**
+   * @brief Gets the current time of the ROS clock, the time base of get_ego_pose_at.
+   */
+  double get_ros_time() const { return GodotRviz2::get_instance().get_node()->now().seconds(); }
+
+private:
+  /**
+   * @brief Retrieves the latest transformation from base_link to map.
+   *
+   * Goes through the shared TfCache, so every caller in one frame shares a single TF2 lookup.
+   */
+  static std::optional<geometry_msgs::msg::Transform> lookup_ego_transform()
+  {
+    const auto tf_cache = GodotRviz2::get_instance().get_tf_cache();
+    return tf_cache->lookup("base_link", "map", rclcpp::Time(0));
+  }
+
+  /**
+   * @brief Converts a transformation into the Dictionary returned by get_ego_pose.
+   */
+  static Dictionary to_pose_dict(const std::optional<geometry_msgs::msg::Transform> & transform)
+  {
+    Dictionary pose;
+    pose["valid"] = transform.has_value();
+    pose["position"] = transform ? ros2_to_godot(transform.value().translation) : Vector3();
+    pose["rotation"] = transform ? to_godot_rotation(transform.value().rotation) : Vector3();
+    return pose;
+  }
+
+  /**
+   * @brief Converts a ROS 2 quaternion to roll, pitch, yaw in Godot's coordinate system.
+   */
+  static Vector3 to_godot_rotation(const geometry_msgs::msg::Quaternion & rotation)
+  {
     double roll, pitch, yaw;
 
     // Convert the quaternion to roll, pitch, yaw
@@ -0,0 +1,235 @@
+//
+//  Copyright 2022 Yukihiro Saito. All rights reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#pragma once
+
+#include "core/object/ref_counted.h"
+#include "core/string/ustring.h"
+#include "core/variant/variant.h"
+#include "godot_rviz2.hpp"
+#include "latest_message.hpp"
+#include "message_history.hpp"
+#include "topic_stats.hpp"
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Marks the message of the last get() as consumed and records the consumption.
+ *
+ * Shared by set_old of the subscribers and their snapshots. Called from the main thread.
+ *
+ * @param latest_msg The slot of the subscriber.
+ * @param stats The statistics of the topic, or nullptr if not subscribed yet.
+ * @return std::shared_ptr<const T> The consumed message, or nullptr if nothing was received yet.
+ */
+template <class T>
+std::shared_ptr<const T> consume_latest_message(
+  LatestMessage<T> & latest_msg, const std::shared_ptr<TopicStats> & stats)
+{
+  const uint64_t consumed_generation = latest_msg.get_consumed_generation();
+  auto msg = latest_msg.set_old();
+  if (!stats || !msg) return msg;
+  stats->record_consume(
+    latest_msg.get_consumed_generation() - consumed_generation,
+    message_history::get_stamp(*msg, rclcpp::Time()),
+    GodotRviz2::get_instance().get_node()->now().nanoseconds());
+  return msg;
+}
+
+/**
+ * @class SnapshotSource
+ * @brief A subscriber as seen by FrameSnapshot, independent of its message type.
+ *
+ * Owned by the subscriber, so a FrameSnapshot only keeps a weak reference and drops sources whose
+ * subscriber was freed.
+ */
+class SnapshotSource
+{
+public:
+  virtual ~SnapshotSource() = default;
+
+  /**
+   * @brief Pins and consumes the latest message.
+   *
+   * @return bool Whether the message is newer than the one pinned by the previous capture.
+   */
+  virtual bool capture() = 0;
+
+  /**
+   * @brief Unpins the message, so the subscriber reads the latest message again.
+   */
+  virtual void release() = 0;
+
+  /**
+   * @brief Whether the last capture pinned a new message.
+   */
+  bool is_dirty() const { return dirty_; }
+
+  /**
+   * @brief Whether a FrameSnapshot captures this source.
+   */
+  bool is_attached() const { return attached_; }
+  void set_attached(const bool attached)
+  {
+    attached_ = attached;
+    if (!attached) release();
+  }
+
+protected:
+  bool dirty_ = false;
+
+private:
+  bool attached_ = false;
+};
+
+/**
+ * @class MessageSnapshot
+ * @brief The SnapshotSource of a subscriber of messages of type T.
+ */
+template <class T>
+class MessageSnapshot : public SnapshotSource
+{
+public:
+  using ConstSharedPtr = std::shared_ptr<const T>;
+
+  explicit MessageSnapshot(std::shared_ptr<LatestMessage<T>> latest_msg)
+  : latest_msg_(std::move(latest_msg))
+  {
+  }
+
+  /**
+   * @brief Sets the statistics the consumed messages are recorded in.
+   */
+  void set_stats(std::shared_ptr<TopicStats> stats) { stats_ = std::move(stats); }
+
+  bool capture() override
+  {
+    const uint64_t consumed_generation = latest_msg_->get_consumed_generation();
+    // Fetch the latest message, so exactly the pinned message is marked as consumed
+    latest_msg_->get();
+    pinned_ = consume_latest_message(*latest_msg_, stats_);
+    dirty_ = latest_msg_->get_consumed_generation() != consumed_generation;
+    return dirty_;
+  }
+
+  void release() override
+  {
+    pinned_.reset();
+    dirty_ = false;
+  }
+
+  /**
+   * @brief Gets the message pinned by the last capture, nullptr if none.
+   */
+  const ConstSharedPtr & get_pinned() const { return pinned_; }
+
+private:
+  std::shared_ptr<LatestMessage<T>> latest_msg_;
+  std::shared_ptr<TopicStats> stats_;
+  ConstSharedPtr pinned_;
+};
+
+/**
+ * @class FrameSnapshot
+ * @brief Captures the latest message of every attached subscriber at once, once per frame.
+ *
+ * Subscribers are attached with their attach_to_snapshot method. capture() pins the latest message
+ * of each of them, so every getter called until the next capture converts the same, consistent
+ * set of messages, e.g. objects and the trajectory of the same planning cycle, even while new
+ * messages keep arriving on executor threads. Precomputed results are used whenever they were
+ * built from the pinned message.
+ *
+ * While attached, a subscriber's has_new reports whether the last capture pinned a new message and
+ * set_old does nothing, since capture already consumed the message. Call capture from one script,
+ * e.g. Main.gd, before the visualizers process the frame.
+ */
+class FrameSnapshot : public RefCounted
+{
+  GDCLASS(FrameSnapshot, RefCounted);
+
+public:
+  /**
+   * @brief Pins the latest message of every attached subscriber.
+   *
+   * @return PackedStringArray The names of the subscribers that received a new message since the
+   * previous capture.
+   */
+  PackedStringArray capture();
+
+  /**
+   * @brief Unpins every message, so the subscribers read their latest message again.
+   */
+  void release();
+
+  /**
+   * @brief Checks whether the last capture pinned a new message of a subscriber.
+   *
+   * @param name The name the subscriber was attached with.
+   */
+  bool is_dirty(const String & name) const;
+
+  /**
+   * @brief Gets the names returned by the last capture.
+   */
+  PackedStringArray get_dirty() const { return dirty_; }
+
+  /**
+   * @brief Gets the names of the attached subscribers.
+   */
+  PackedStringArray get_names() const;
+
+  /**
+   * @brief Gets the number of captures so far.
+   */
+  int get_frame() const { return frame_; }
+
+  /**
+   * @brief Attaches a subscriber. Called by attach_to_snapshot of the subscribers.
+   *
+   * @param name Name of the subscriber in the dirty set. Replaces a subscriber of the same name.
+   * @param source The snapshot state of the subscriber.
+   */
+  void add_source(const String & name, const std::shared_ptr<SnapshotSource> & source);
+
+  /**
+   * @brief Detaches a subscriber, which then reads its latest message again.
+   *
+   * @param name The name the subscriber was attached with.
+   */
+  void remove(const String & name);
+
+  FrameSnapshot() = default;
+  ~FrameSnapshot();
+
+protected:
+  /**
+   * @brief Binds methods to the Godot system.
+   */
+  static void _bind_methods();
+
+private:
+  struct Entry
+  {
+    String name;
+    std::weak_ptr<SnapshotSource> source;
+  };
+
+  std::vector<Entry> entries_;
+  PackedStringArray dirty_;
+  int frame_ = 0;
+};
@@ -17,12 +17,18 @@
 #pragma once
 
 #include "rclcpp/rclcpp.hpp"
+#include "tf_cache.hpp"
+#include "topic_stats.hpp"
 
 #include "sensor_msgs/msg/point_cloud2.hpp"
 
 #include <tf2_ros/buffer.h>
+#include <tf2_ros/create_timer_ros.h>
 #include <tf2_ros/transform_listener.h>
 
+#include <future>
+#include <memory>
+
 /**
  * @class GodotRviz2
  * @brief The GodotRviz2 class is a singleton that initializes and manages ROS 2 node and TF2 buffer
@@ -65,10 +71,51 @@ public:  // for singleton
    */
   std::shared_ptr<tf2_ros::Buffer> get_tf_buffer() { return tf_buffer_; }
 
+  /**
+   * @brief Gets the per-frame cache of TF2 lookups.
+   *
+   * @return std::shared_ptr<TfCache> Shared pointer to the TF2 lookup cache.
+   */
+  std::shared_ptr<TfCache> get_tf_cache() { return tf_cache_; }
+
+  /**
+   * @brief Gets the statistics of every subscribed topic.
+   *
+   * @return std::shared_ptr<TopicStatsRegistry> Shared pointer to the statistics registry.
+   */
+  std::shared_ptr<TopicStatsRegistry> get_topic_stats() { return topic_stats_; }
+
+  /**
+   * @brief Starts spinning the ROS 2 node on a background executor.
+   *
+   * A MultiThreadedExecutor is created for the node and spun on its own thread, so subscription
+   * callbacks are serviced as soon as messages arrive instead of once per frame.
+   *
+   * @param num_threads Number of executor threads. 0 uses the number of hardware threads.
+   * @return bool True if the executor was started, false if it was already running.
+   */
+  bool start_executor(const int num_threads = 0);
+
+  /**
+   * @brief Stops the background executor and joins its thread.
+   */
+  void stop_executor();
+
+  /**
+   * @brief Checks whether the background executor is running.
+   *
+   * @return bool True if the node is spun on the background executor.
+   */
+  bool is_executor_running() const { return static_cast<bool>(executor_); }
+
 private:
   std::shared_ptr<rclcpp::Node> node_;
   std::shared_ptr<tf2_ros::Buffer> tf_buffer_;
   std::shared_ptr<tf2_ros::TransformListener> tf_listener_;
+  std::shared_ptr<TfCache> tf_cache_;
+  std::shared_ptr<TopicStatsRegistry> topic_stats_ = std::make_shared<TopicStatsRegistry>();
+  std::shared_ptr<rclcpp::executors::MultiThreadedExecutor> executor_;
+  std::future<void> executor_future_;
 
 private:
   /**
@@ -81,13 +128,21 @@ private:
     rclcpp::init(0, nullptr);
     node_ = std::make_shared<rclcpp::Node>("godot_rviz2_node");
     tf_buffer_ = std::make_shared<tf2_ros::Buffer>(node_->get_clock());
+    // Needed by waitForTransform, see TfMessageFilter
+    tf_buffer_->setCreateTimerInterface(std::make_shared<tf2_ros::CreateTimerROS>(
+      node_->get_node_base_interface(), node_->get_node_timers_interface()));
     tf_listener_ = std::make_shared<tf2_ros::TransformListener>(*tf_buffer_);
+    tf_cache_ = std::make_shared<TfCache>(tf_buffer_);
   }
 
   /**
    * @brief Destructor for GodotRviz2.
    *
-   * Shuts down the ROS 2 environment upon object destruction.
+   * Stops the background executor and shuts down the ROS 2 environment upon object destruction.
    */
-  ~GodotRviz2() { rclcpp::shutdown(); }
+  ~GodotRviz2()
+  {
+    stop_executor();
+    rclcpp::shutdown();
+  }
 };
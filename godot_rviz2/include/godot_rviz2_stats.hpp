@@ -0,0 +1,100 @@
+//
+//  Copyright 2022 Yukihiro Saito. All rights reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#pragma once
+
+#include "core/object/class_db.h"
+#include "core/object/object.h"
+#include "core/string/ustring.h"
+#include "core/variant/dictionary.h"
+#include "rclcpp/rclcpp.hpp"
+
+#include "diagnostic_msgs/msg/diagnostic_array.hpp"
+
+/**
+ * @class GodotRviz2Stats
+ * @brief The GodotRviz2Stats singleton exposes the statistics of every subscribed topic to Godot.
+ *
+ * Each topic reports its receive rate, dropped and overwritten messages, the latency from
+ * header.stamp to the subscription callback and to set_old, and the duration of every getter. The
+ * latencies and durations are summarized by count, mean, p50, p99 and max in seconds. The
+ * statistics can also be published as diagnostic_msgs/DiagnosticArray.
+ */
+class GodotRviz2Stats : public Object
+{
+  GDCLASS(GodotRviz2Stats, Object);
+
+public:
+  /**
+   * @brief Gets the instance registered as the GodotRviz2Stats engine singleton.
+   */
+  static GodotRviz2Stats * get_singleton() { return singleton_; }
+
+  /**
+   * @brief Gets the names of the subscribed topics.
+   */
+  PackedStringArray get_topics() const;
+
+  /**
+   * @brief Gets the statistics of a topic.
+   *
+   * @param topic The topic name as passed to subscribe.
+   * @return Dictionary The "received", "dropped", "overwritten", "consumed" and "rate" values,
+   * the "delivery_latency" and "render_latency" summaries and a "conversions" Dictionary of
+   * summaries by getter name. Empty if the topic is not subscribed.
+   */
+  Dictionary get_topic_stats(const String & topic) const;
+
+  /**
+   * @brief Gets the statistics of every topic, keyed by topic name.
+   */
+  Dictionary get_all_stats() const;
+
+  /**
+   * @brief Clears the statistics of every topic.
+   */
+  void reset();
+
+  /**
+   * @brief Publishes the statistics as a DiagnosticArray with one status per topic.
+   *
+   * The timer runs on the node, so the spinner has to be running.
+   *
+   * @param topic The diagnostics topic.
+   * @param period Publishing period in seconds.
+   */
+  void start_diagnostics(const String & topic = "/diagnostics", const double period = 1.0);
+
+  /**
+   * @brief Stops publishing the statistics.
+   */
+  void stop_diagnostics();
+
+  GodotRviz2Stats();
+  ~GodotRviz2Stats();
+
+protected:
+  /**
+   * @brief Binds methods to the Godot system.
+   */
+  static void _bind_methods();
+
+private:
+  static GodotRviz2Stats * singleton_;
+
+  rclcpp::Publisher<diagnostic_msgs::msg::DiagnosticArray>::SharedPtr diagnostics_publisher_;
+  rclcpp::TimerBase::SharedPtr diagnostics_timer_;
+};
@@ -0,0 +1,59 @@
+//
+//  Copyright 2022 Yukihiro Saito. All rights reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#pragma once
+
+#include "core/math/transform_3d.h"
+#include "core/variant/variant.h"
+#include "scene/resources/multimesh.h"
+
+/**
+ * @brief Instances of one mesh in the layout of MultiMesh.buffer.
+ *
+ * Each instance holds a 3D transform, a color and custom data, so every MultiMesh written by
+ * write_to shares one format.
+ */
+struct InstanceBuffer
+{
+  // Floats per instance: a 3x4 transform, a color and custom data
+  static constexpr int stride = 12 + 4 + 4;
+
+  PackedFloat32Array buffer;
+  int count = 0;
+
+  /**
+   * @brief Appends an instance.
+   *
+   * @param transform Transform of the instance in Godot's coordinate system.
+   * @param color Instance color, COLOR in shaders.
+   * @param custom_data Instance custom data, INSTANCE_CUSTOM in shaders.
+   */
+  void append(const Transform3D & transform, const Color & color, const Color & custom_data);
+
+  /**
+   * @brief Converts the instances into a Dictionary with "buffer" and "count".
+   */
+  Dictionary to_dict() const;
+
+  /**
+   * @brief Writes the instances into a MultiMesh.
+   *
+   * The MultiMesh is set up for 3D transforms, colors and custom data. Its instance count grows to
+   * the next power of two when exceeded and the visible instance count is set to count, so the
+   * MultiMesh is only reallocated when the number of instances grows.
+   */
+  void write_to(const Ref<MultiMesh> & multimesh) const;
+};
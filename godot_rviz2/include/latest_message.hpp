@@ -0,0 +1,133 @@
+//
+//  Copyright 2022 Yukihiro Saito. All rights reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+/**
+ * @class LatestMessage
+ * @brief Wait-free single-producer/single-consumer slot holding the latest received message.
+ *
+ * T is usually a ROS 2 message type, but any type shared by std::shared_ptr<const T> can be
+ * exchanged, such as buffers prepared from a message.
+ *
+ * The producer is the subscription callback, which may run on a background executor thread. Its
+ * callback group is mutually exclusive, so there is only one producer at a time. The consumer is
+ * the Godot main thread polling has_new() and the getters.
+ *
+ * Messages are exchanged through a triple buffer: the producer fills its back slot and swaps it
+ * with the shared middle slot, and the consumer swaps the middle slot into its front slot when it
+ * is marked dirty. Neither side ever waits for the other. Every published message gets a
+ * generation number, so has_new() is a single atomic load.
+ *
+ * The subscription callback holds its own reference to this object, so a callback that is still
+ * running when the subscriber is destroyed never touches freed memory.
+ */
+template <class T>
+class LatestMessage
+{
+public:
+  using ConstSharedPtr = std::shared_ptr<const T>;
+
+  /**
+   * @brief Publishes a new message. Called by the producer only.
+   *
+   * @param msg The received message.
+   */
+  void set(const ConstSharedPtr & msg)
+  {
+    const uint64_t generation = generation_.load(std::memory_order_relaxed) + 1;
+    slots_[back_].msg = msg;
+    slots_[back_].generation = generation;
+    back_ = middle_.exchange(back_ | dirty_bit, std::memory_order_acq_rel) & index_mask;
+    generation_.store(generation, std::memory_order_release);
+  }
+
+  /**
+   * @brief Gets the latest message. Called by the consumer only.
+   *
+   * @return ConstSharedPtr The latest message, or nullptr if nothing has been received yet.
+   */
+  ConstSharedPtr get()
+  {
+    if (middle_.load(std::memory_order_relaxed) & dirty_bit) {
+      front_ = middle_.exchange(front_, std::memory_order_acq_rel) & index_mask;
+    }
+    fetched_ = true;
+    return slots_[front_].msg;
+  }
+
+  /**
+   * @brief Checks whether a message newer than the last consumed one was published.
+   */
+  bool has_new() const
+  {
+    return generation_.load(std::memory_order_acquire) != consumed_generation_;
+  }
+
+  /**
+   * @brief Marks the message returned by the last get() as consumed.
+   *
+   * A message published after that get() keeps has_new() true. If get() was not called since the
+   * previous set_old(), the latest message is marked as consumed.
+   *
+   * @return ConstSharedPtr The consumed message, or nullptr if nothing has been received yet.
+   */
+  ConstSharedPtr set_old()
+  {
+    if (!fetched_) get();
+    consumed_generation_ = slots_[front_].generation;
+    fetched_ = false;
+    return slots_[front_].msg;
+  }
+
+  /**
+   * @brief Gets the generation of the last consumed message. Called by the consumer only.
+   */
+  uint64_t get_consumed_generation() const { return consumed_generation_; }
+
+  /**
+   * @brief Gets the number of messages published so far.
+   */
+  uint64_t generation() const { return generation_.load(std::memory_order_acquire); }
+
+private:
+  struct Slot
+  {
+    ConstSharedPtr msg;
+    uint64_t generation = 0;
+  };
+
+  static constexpr uint8_t index_mask = 0x3;
+  static constexpr uint8_t dirty_bit = 0x4;
+
+  std::array<Slot, 3> slots_;
+  // Index of the slot shared by both sides, with dirty_bit set when it holds an unread message
+  std::atomic<uint8_t> middle_{1};
+  std::atomic<uint64_t> generation_{0};
+
+  // Producer side
+  uint8_t back_ = 0;
+
+  // Consumer side
+  uint8_t front_ = 2;
+  uint64_t consumed_generation_ = 0;
+  bool fetched_ = false;
+};
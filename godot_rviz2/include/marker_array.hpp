@@ -19,10 +19,30 @@
 #include "core/object/ref_counted.h"
 #include "core/string/ustring.h"
 #include "core/variant/variant.h"
+#include "disk_cache.hpp"
+#include "instance_buffer.hpp"
+#include "marker_store.hpp"
+#include "mesh_arrays.hpp"
 #include "topic_subscriber.hpp"
 
 #include "visualization_msgs/msg/marker_array.hpp"
 
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+/**
+ * @class MarkerArray
+ * @brief The MarkerArray class keeps the markers of a MarkerArray topic and triangulates them.
+ *
+ * Received messages are applied incrementally to a MarkerStore, so publishers may send only the
+ * markers that changed. Triangle lists are cached per namespace and rebuilt only when a marker of
+ * that namespace changes.
+ */
 class MarkerArray : public RefCounted
 {
   GDCLASS(MarkerArray, RefCounted);
@@ -30,11 +50,189 @@ class MarkerArray : public RefCounted
 
 public:
   Array get_triangle_list(const String & ns);
+
+  /**
+   * @brief Gets the triangle list of a namespace as Mesh.ARRAY_* channels.
+   *
+   * @param ns Namespace of the TRIANGLE_LIST markers.
+   * @return Array to pass to add_surface_from_arrays, a copy the caller may modify.
+   */
+  Array get_triangle_list_arrays(const String & ns);
+
+  /**
+   * @brief Gets the triangle lists of several namespaces merged into one set of channels.
+   *
+   * Each namespace is looked up directly, and the merged channels are allocated once.
+   *
+   * @param namespaces Namespaces of the TRIANGLE_LIST markers.
+   * @return Array to pass to add_surface_from_arrays.
+   */
+  Array get_merged_triangle_list_arrays(const PackedStringArray & namespaces);
+
+  /**
+   * @brief Gets the merged triangle lists of several namespaces split into square map tiles.
+   *
+   * Meant for static maps: one surface per tile lets Godot cull the tiles outside the view
+   * frustum, and distance-based visibility can drop far tiles. Every triangle is assigned to the
+   * tile containing its centroid, see MeshArrays::split_into_tiles. The tiles are rebuilt only
+   * when a namespace changes.
+   *
+   * @param namespaces Namespaces of the TRIANGLE_LIST markers.
+   * @param tile_size Edge length of the tiles in meters.
+   * @return Array of Dictionaries with "arrays" (Mesh.ARRAY_* channels), "aabb" (AABB) and
+   * "tile" (Vector2i).
+   */
+  Array get_tiled_triangle_list_arrays(
+    const PackedStringArray & namespaces, const float tile_size = 100.0);
   Array get_color_spheres(const String & ns);
 
-  MarkerArray() = default;
+  /**
+   * @brief Gets the SPHERE and SPHERE_LIST markers of a namespace as instances of a unit sphere.
+   *
+   * Each SPHERE marker and each point of a SPHERE_LIST marker is one instance, scaled by the
+   * marker scale and colored by the marker or point color. The custom data holds the marker ID.
+   *
+   * @param ns The namespace.
+   * @return Dictionary with "buffer" (MultiMesh.buffer layout with colors and custom data) and
+   * "count" (int).
+   */
+  Dictionary get_sphere_instances(const String & ns);
+
+  /**
+   * @brief Gets the CUBE and CUBE_LIST markers of a namespace as instances of a unit cube.
+   *
+   * @param ns The namespace.
+   * @return Dictionary in the format of get_sphere_instances.
+   */
+  Dictionary get_cube_instances(const String & ns);
+
+  /**
+   * @brief Gets the LINE_LIST and LINE_STRIP markers of a namespace as line segments.
+   *
+   * The line width is not applied, Godot draws lines one pixel wide.
+   *
+   * @param ns The namespace.
+   * @return Array of Mesh.ARRAY_* channels with vertices and colors for PRIMITIVE_LINES.
+   */
+  Array get_line_list_arrays(const String & ns);
+
+  /**
+   * @brief Writes the sphere and cube instances of a namespace into MultiMeshes.
+   *
+   * See InstanceBuffer::write_to for how the MultiMeshes are set up.
+   *
+   * @param ns The namespace.
+   * @param sphere_multimesh MultiMesh whose mesh is a sphere with a diameter of 1, or null.
+   * @param cube_multimesh MultiMesh whose mesh is a unit cube, or null.
+   */
+  void update_multimesh(
+    const String & ns, const Ref<MultiMesh> & sphere_multimesh,
+    const Ref<MultiMesh> & cube_multimesh);
+
+  /**
+   * @brief Checks whether the markers of a namespace changed since set_old_in_namespace.
+   *
+   * Also reports markers that expired in the meantime.
+   *
+   * @param ns The namespace.
+   */
+  bool has_new_in_namespace(const String & ns);
+
+  /**
+   * @brief Marks the current markers of a namespace as seen.
+   *
+   * @param ns The namespace.
+   */
+  void set_old_in_namespace(const String & ns);
+
+  /**
+   * @brief Rebuilds the triangle lists of the given namespaces in the subscription callback.
+   *
+   * Only the namespaces changed by a message are rebuilt.
+   *
+   * @param namespaces Namespaces get_triangle_list will be called with.
+   */
+  void enable_precompute(const PackedStringArray & namespaces);
+  void disable_precompute();
+
+  /**
+   * @brief Enables the on-disk cache of precomputed triangle lists.
+   *
+   * Triangle lists are stored under user:// keyed by a hash of the markers of their namespace,
+   * so the same map is not triangulated again on the next launch.
+   *
+   * @param enabled Whether to use the cache.
+   */
+  void set_disk_cache(const bool enabled);
+  bool is_disk_cache_enabled() const { return disk_cache_->is_enabled(); }
+
+  /**
+   * @brief Sets the number of markers triangulated per task on Godot's WorkerThreadPool.
+   *
+   * Namespaces with more markers are split into chunks of this size and triangulated in parallel
+   * into disjoint ranges of one output buffer. 0 disables parallel triangulation.
+   *
+   * @param chunk_size Number of markers per task.
+   */
+  void set_chunk_size(const int chunk_size);
+  int get_chunk_size() const;
+
+  MarkerArray();
   ~MarkerArray() = default;
 
 protected:
   static void _bind_methods();
+
+private:
+  /**
+   * @brief A triangle list and the namespace revision it was built from.
+   */
+  struct TriangleListCache
+  {
+    uint64_t revision = 0;
+    // MeshArrays::to_array() result
+    Array triangle_list;
+  };
+
+  /**
+   * @brief State shared with the subscription callback.
+   */
+  struct SharedState
+  {
+    MarkerStore store;
+    std::mutex mutex;
+    std::unordered_set<std::string> precompute_namespaces;
+    std::unordered_map<std::string, TriangleListCache> triangle_lists;
+    std::atomic<int> chunk_size{1024};
+  };
+
+  std::shared_ptr<DiskCache> disk_cache_;
+  std::shared_ptr<SharedState> state_;
+  // Revision of each namespace at the last set_old_in_namespace call
+  std::unordered_map<std::string, uint64_t> consumed_revisions_;
+
+  /**
+   * @brief Tiles of the last get_tiled_triangle_list_arrays call and what they were built from.
+   */
+  struct TileCache
+  {
+    PackedStringArray namespaces;
+    std::vector<uint64_t> revisions;
+    float tile_size = 0.0;
+    std::vector<MeshTile> tiles;
+  };
+  TileCache tile_cache_;
+
+  /**
+   * @brief Gets the triangle list of a namespace, building it if its markers changed.
+   *
+   * Safe to call from any thread.
+   *
+   * @param state The shared state.
+   * @param disk_cache The disk cache.
+   * @param ns The namespace.
+   * @return Array MeshArrays::to_array() result.
+   */
+  static Array build_triangle_list(
+    SharedState & state, const DiskCache & disk_cache, const std::string & ns);
 };
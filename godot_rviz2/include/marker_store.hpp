@@ -0,0 +1,117 @@
+//
+//  Copyright 2022 Yukihiro Saito. All rights reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#pragma once
+
+#include "visualization_msgs/msg/marker.hpp"
+#include "visualization_msgs/msg/marker_array.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @class MarkerStore
+ * @brief Keeps the markers currently alive, keyed by namespace and ID.
+ *
+ * MarkerArray messages are applied as incremental updates, like RViz does: ADD/MODIFY replaces
+ * the marker with the same namespace and ID, DELETE removes it, and DELETEALL removes the markers
+ * of its namespace, or every marker if the namespace is empty. Markers with a non-zero lifetime
+ * expire that long after they were received. Each namespace carries a revision that changes
+ * whenever one of its markers changes, so readers can tell which namespaces need rebuilding.
+ * Safe to use from any thread.
+ */
+class MarkerStore
+{
+public:
+  using Clock = std::chrono::steady_clock;
+  using MarkerArrayConstPtr = std::shared_ptr<const visualization_msgs::msg::MarkerArray>;
+
+  /**
+   * @brief The markers of a namespace at one revision.
+   */
+  struct NamespaceSnapshot
+  {
+    // 0 if the namespace has never been seen
+    uint64_t revision = 0;
+    MarkerArrayConstPtr markers;
+  };
+
+  /**
+   * @brief Applies the actions of a MarkerArray message.
+   *
+   * @param msg The message.
+   * @param now Receive time the lifetimes count from.
+   * @return std::vector<std::string> Namespaces whose markers changed.
+   */
+  std::vector<std::string> apply(
+    const visualization_msgs::msg::MarkerArray & msg, const Clock::time_point now);
+
+  /**
+   * @brief Removes the markers whose lifetime has passed.
+   *
+   * @param now Current time.
+   * @return std::vector<std::string> Namespaces whose markers changed.
+   */
+  std::vector<std::string> expire(const Clock::time_point now);
+
+  /**
+   * @brief Gets the markers of a namespace.
+   *
+   * @param ns The namespace.
+   * @return NamespaceSnapshot The markers, ordered by ID, and the revision they belong to.
+   */
+  NamespaceSnapshot get_namespace(const std::string & ns);
+
+  /**
+   * @brief Gets the current revision of a namespace, 0 if it has never been seen.
+   */
+  uint64_t get_revision(const std::string & ns) const;
+
+private:
+  struct StoredMarker
+  {
+    visualization_msgs::msg::Marker marker;
+    std::optional<Clock::time_point> expiry;
+  };
+
+  struct Namespace
+  {
+    std::map<int32_t, StoredMarker> markers;
+    uint64_t revision = 0;
+    // Built on demand and dropped on every change
+    MarkerArrayConstPtr snapshot;
+  };
+
+  mutable std::mutex mutex_;
+  std::unordered_map<std::string, Namespace> namespaces_;
+  // Revisions are unique across namespaces, so a namespace that is emptied and refilled never
+  // returns to a revision a reader has already seen
+  uint64_t next_revision_ = 1;
+  // Earliest expiry of any stored marker
+  std::optional<Clock::time_point> next_expiry_;
+
+  /**
+   * @brief Marks a namespace as changed.
+   */
+  void touch(const std::string & ns, Namespace & markers, std::vector<std::string> & changed);
+};
@@ -0,0 +1,121 @@
+//
+//  Copyright 2022 Yukihiro Saito. All rights reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#pragma once
+
+#include "core/variant/variant.h"
+#include "rviz_core/mesh_buffers.hpp"
+
+#include <vector>
+
+struct MeshTile;
+
+/**
+ * @brief Per-vertex channels of a mesh surface, stored as packed arrays.
+ *
+ * to_array() returns the channels in the layout expected by Mesh::add_surface_from_arrays, so
+ * scripts can build a surface without touching individual vertices. Empty channels are left null.
+ */
+struct MeshArrays
+{
+  PackedVector3Array vertices;
+  PackedVector3Array normals;
+  PackedColorArray colors;
+  // Per-vertex velocity, passed as ARRAY_CUSTOM0 in the ARRAY_CUSTOM_R_FLOAT format
+  PackedFloat32Array velocities;
+  // Triangle indices. Empty for non-indexed geometry.
+  PackedInt32Array indices;
+
+  /**
+   * @brief Appends a vertex with its normal.
+   */
+  void append(const Vector3 & vertex, const Vector3 & normal)
+  {
+    vertices.push_back(vertex);
+    normals.push_back(normal);
+  }
+
+  /**
+   * @brief Gets the number of vertices.
+   */
+  int size() const { return vertices.size(); }
+
+  /**
+   * @brief Converts the channels into an Array of Mesh::ARRAY_MAX elements.
+   *
+   * Surfaces with velocities have to be added with the
+   * `Mesh.ARRAY_CUSTOM_R_FLOAT << Mesh.ARRAY_FORMAT_CUSTOM0_SHIFT` flag.
+   */
+  Array to_array() const;
+
+  /**
+   * @brief Creates a non-indexed copy with one vertex per index.
+   */
+  MeshArrays expand_indices() const;
+
+  /**
+   * @brief Converts the channels into an Array with one Dictionary per vertex.
+   *
+   * Builds the "position", "normal", "color" and "velocity" keys of the non-empty channels, as
+   * returned by the original getters. Indexed geometry is expanded first.
+   */
+  Array to_point_dicts() const;
+
+  /**
+   * @brief Restores the channels from an Array created by to_array().
+   */
+  static MeshArrays from_array(const Array & array);
+
+  /**
+   * @brief Wraps the buffers of the Godot-free core as packed arrays.
+   *
+   * The buffers are already in Godot's axes, so each channel is copied as a whole.
+   */
+  static MeshArrays from_buffers(const rviz_core::MeshBuffers & buffers);
+
+  /**
+   * @brief Concatenates several sets of channels into one, allocating each channel once.
+   *
+   * A channel is kept only if every non-empty part has it. Indices are offset to the merged
+   * vertices; if only some parts are indexed, the indexed ones are expanded first.
+   */
+  static MeshArrays concatenate(const std::vector<MeshArrays> & parts);
+
+  /**
+   * @brief Splits a triangle list into square tiles of the ground plane.
+   *
+   * Each triangle goes to the tile containing its centroid in Godot's x-z plane, so triangles
+   * crossing a border are kept whole and the bounds of neighbouring tiles may overlap. Indexed
+   * geometry is expanded first.
+   *
+   * @param tile_size Edge length of the tiles in meters.
+   * @return std::vector<MeshTile> One entry per non-empty tile, ordered by tile.
+   */
+  std::vector<MeshTile> split_into_tiles(const float tile_size) const;
+};
+
+/**
+ * @brief The triangles of a mesh within one tile of the ground plane, see split_into_tiles.
+ */
+struct MeshTile
+{
+  // Tile coordinates: the tile spans [x, x + 1) * tile_size along x and [y, y + 1) * tile_size
+  // along z
+  Vector2i tile;
+  // Bounds of the triangles of the tile
+  AABB aabb;
+  MeshArrays arrays;
+};
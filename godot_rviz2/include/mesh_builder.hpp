@@ -0,0 +1,124 @@
+//
+//  Copyright 2022 Yukihiro Saito. All rights reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#pragma once
+
+#include "core/object/ref_counted.h"
+#include "core/variant/variant.h"
+#include "scene/3d/mesh_instance_3d.h"
+#include "scene/resources/mesh.h"
+
+#include <vector>
+
+/**
+ * @class MeshBuilder
+ * @brief The MeshBuilder class owns an ArrayMesh whose surfaces keep their GPU buffers across
+ * updates.
+ *
+ * Each surface is allocated with a vertex capacity. Updates that fit into the capacity rewrite the
+ * existing vertex and attribute buffers in place, and the unused tail is filled with copies of the
+ * last vertex, which only form degenerate primitives. The capacity grows to the next power of two
+ * when it is exceeded, and the surfaces are recreated only then or when the vertex format or the
+ * primitive type changes. Meant for triangle and line primitives, where the padding is invisible.
+ */
+class MeshBuilder : public RefCounted
+{
+  GDCLASS(MeshBuilder, RefCounted);
+
+public:
+  /**
+   * @brief Replaces the geometry of a surface.
+   *
+   * @param surface Index of the surface. Must be an existing surface or the next new one.
+   * @param primitive Primitive type of the surface.
+   * @param arrays Mesh.ARRAY_MAX sized arrays as passed to ArrayMesh.add_surface_from_arrays.
+   * Indexed arrays are not supported by in-place updates and recreate the surfaces every time.
+   * @param flags Format flags as passed to ArrayMesh.add_surface_from_arrays.
+   */
+  void update_surface(
+    const int surface, const Mesh::PrimitiveType primitive, const Array & arrays,
+    const int64_t flags = 0);
+
+  /**
+   * @brief Hides the geometry of a surface while keeping its buffers.
+   *
+   * @param surface Index of the surface.
+   */
+  void clear_surface(const int surface);
+
+  /**
+   * @brief Removes every surface and releases the buffers.
+   */
+  void clear();
+
+  /**
+   * @brief Gets the vertex capacity of a surface, or 0 if the surface does not exist.
+   */
+  int get_surface_capacity(const int surface) const;
+
+  /**
+   * @brief Gets the mesh the surfaces are written into.
+   */
+  Ref<ArrayMesh> get_mesh() const { return mesh_; }
+
+  /**
+   * @brief Makes a MeshInstance3D draw the mesh of this builder.
+   *
+   * @param mesh_instance The target MeshInstance3D.
+   */
+  void attach(MeshInstance3D * mesh_instance) const;
+
+  MeshBuilder();
+  ~MeshBuilder() = default;
+
+protected:
+  /**
+   * @brief Binds methods to the Godot system.
+   */
+  static void _bind_methods();
+
+private:
+  /**
+   * @brief The state needed to recreate a surface.
+   */
+  struct Surface
+  {
+    Mesh::PrimitiveType primitive = Mesh::PRIMITIVE_TRIANGLES;
+    int64_t flags = 0;
+    // Arrays padded to the capacity
+    Array arrays;
+    int capacity = 0;
+    AABB aabb;
+  };
+
+  // Smallest capacity a surface is created with
+  static constexpr int min_capacity = 64;
+
+  Ref<ArrayMesh> mesh_;
+  std::vector<Surface> surfaces_;
+
+  /**
+   * @brief Recreates every surface of the mesh from the stored arrays.
+   */
+  void rebuild();
+
+  /**
+   * @brief Sets the custom AABB of the mesh to the merged AABB of the surfaces.
+   *
+   * The surface AABBs computed at creation would otherwise be used for culling.
+   */
+  void update_custom_aabb();
+};
@@ -0,0 +1,154 @@
+//
+//  Copyright 2022 Yukihiro Saito. All rights reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#pragma once
+
+#include "rclcpp/time.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+namespace message_history
+{
+template <class MsgT, class = void>
+struct has_header_stamp : std::false_type
+{
+};
+
+template <class MsgT>
+struct has_header_stamp<MsgT, std::void_t<decltype(std::declval<MsgT>().header.stamp)>>
+: std::true_type
+{
+};
+
+template <class MsgT, class = void>
+struct has_stamp : std::false_type
+{
+};
+
+template <class MsgT>
+struct has_stamp<MsgT, std::void_t<decltype(std::declval<MsgT>().stamp)>> : std::true_type
+{
+};
+
+/**
+ * @brief Gets the stamp of a message in nanoseconds.
+ *
+ * Uses header.stamp or stamp if the message has one and it is set, the receive time otherwise.
+ */
+template <class MsgT>
+int64_t get_stamp(const MsgT & msg, const rclcpp::Time & receive_time)
+{
+  int64_t stamp = 0;
+  if constexpr (has_header_stamp<MsgT>::value) {
+    stamp = rclcpp::Time(msg.header.stamp).nanoseconds();
+  } else if constexpr (has_stamp<MsgT>::value) {
+    stamp = rclcpp::Time(msg.stamp).nanoseconds();
+  }
+  return stamp != 0 ? stamp : receive_time.nanoseconds();
+}
+}  // namespace message_history
+
+/**
+ * @class MessageHistory
+ * @brief Short history of received messages ordered by stamp, for rendering at a past time.
+ *
+ * Holds up to capacity messages, dropping the oldest first. A capacity of 0 disables the history.
+ * The subscription callback pushes, the Godot main thread looks samples up. Safe to use from any
+ * thread.
+ */
+template <class MsgT>
+class MessageHistory
+{
+public:
+  using ConstSharedPtr = typename MsgT::ConstSharedPtr;
+
+  /**
+   * @brief A message and the stamp it is ordered by.
+   */
+  struct Sample
+  {
+    // Nanoseconds, in the clock of the stamps
+    int64_t stamp;
+    ConstSharedPtr msg;
+  };
+
+  /**
+   * @brief Sets the number of messages kept. Drops the oldest messages exceeding it.
+   */
+  void set_capacity(const size_t capacity)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    capacity_ = capacity;
+    while (samples_.size() > capacity_) samples_.pop_front();
+  }
+
+  size_t get_capacity() const
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return capacity_;
+  }
+
+  /**
+   * @brief Adds a received message. Does nothing while the history is disabled.
+   *
+   * @param msg The message.
+   * @param receive_time Used as the stamp of messages without one.
+   */
+  void push(const ConstSharedPtr & msg, const rclcpp::Time & receive_time)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (capacity_ == 0) return;
+    const int64_t stamp = message_history::get_stamp(*msg, receive_time);
+    // Messages usually arrive in order, so this is almost always the end
+    const auto it = std::upper_bound(
+      samples_.begin(), samples_.end(), stamp,
+      [](const int64_t value, const Sample & sample) { return value < sample.stamp; });
+    samples_.insert(it, Sample{stamp, msg});
+    while (samples_.size() > capacity_) samples_.pop_front();
+  }
+
+  /**
+   * @brief Gets the samples around a time.
+   *
+   * @param stamp The time in nanoseconds.
+   * @return The newest sample stamped at or before the time, or the oldest sample if every sample
+   * is newer, and the sample following it, if any. std::nullopt if the history is empty.
+   */
+  std::optional<std::pair<Sample, std::optional<Sample>>> get_bracket(const int64_t stamp) const
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (samples_.empty()) return std::nullopt;
+    auto it = std::upper_bound(
+      samples_.begin(), samples_.end(), stamp,
+      [](const int64_t value, const Sample & sample) { return value < sample.stamp; });
+    if (it != samples_.begin()) --it;
+    const auto next = std::next(it);
+    return std::make_pair(
+      *it, next != samples_.end() ? std::optional<Sample>(*next) : std::optional<Sample>());
+  }
+
+private:
+  mutable std::mutex mutex_;
+  size_t capacity_ = 0;
+  std::deque<Sample> samples_;
+};
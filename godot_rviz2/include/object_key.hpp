@@ -0,0 +1,48 @@
+//
+//  Copyright 2022 Yukihiro Saito. All rights reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+
+#pragma once
+
+#include "unique_identifier_msgs/msg/uuid.hpp"
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+// Object ID as a hash map key, stored inline instead of on the heap
+using ObjectKey = std::array<uint8_t, 16>;
+
+/**
+ * @brief Hashes an object ID. UUIDs are random, so their first 8 bytes are hash enough.
+ */
+struct ObjectKeyHash
+{
+  size_t operator()(const ObjectKey & key) const
+  {
+    uint64_t hash;
+    std::memcpy(&hash, key.data(), sizeof(hash));
+    return static_cast<size_t>(hash);
+  }
+};
+
+/**
+ * @brief Gets an object ID as a hash map key.
+ */
+inline const ObjectKey & get_uuid_key(const unique_identifier_msgs::msg::UUID & uuid)
+{
+  return uuid.uuid;
+}
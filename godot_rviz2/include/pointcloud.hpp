@@ -19,10 +19,89 @@
 #include "core/object/ref_counted.h"
 #include "core/string/ustring.h"
 #include "core/variant/variant.h"
+#include "disk_cache.hpp"
+#include "mesh_arrays.hpp"
+#include "precompute.hpp"
+#include "tf_message_filter.hpp"
 #include "topic_subscriber.hpp"
 
 #include "sensor_msgs/msg/point_cloud2.hpp"
 
+/**
+ * @brief Parameters of a point cloud conversion.
+ */
+struct PointCloudConversionParam
+{
+  // Target frame ID
+  String frame_id;
+  // Points converted per worker task. 0 converts the whole cloud on the calling thread.
+  int chunk_size = 0;
+  // Leaf size of the voxel grid filter in meters. 0 disables the filter.
+  float voxel_size = 0.0;
+  // Maximum number of output points. 0 means no limit.
+  int max_points = 0;
+  // Point field decoded into per-point colors. Empty converts positions only.
+  String color_field;
+  // Field values mapped to the ends of the colormap. If color_min >= color_max, the range of the
+  // message is used.
+  float color_min = 0.0;
+  float color_max = 0.0;
+
+  bool operator==(const PointCloudConversionParam & other) const
+  {
+    return frame_id == other.frame_id && chunk_size == other.chunk_size &&
+           voxel_size == other.voxel_size && max_points == other.max_points &&
+           color_field == other.color_field && color_min == other.color_min &&
+           color_max == other.color_max;
+  }
+};
+
+/**
+ * @brief Converts a point cloud message and downsamples it as requested by the parameters.
+ *
+ * Safe to call from any thread. The color field of the parameters is ignored.
+ *
+ * @param msg The point cloud message.
+ * @param param The conversion parameters.
+ * @return PackedVector3Array The converted points, or an empty array if the transform failed.
+ */
+PackedVector3Array convert_pointcloud(
+  const sensor_msgs::msg::PointCloud2 & msg, const PointCloudConversionParam & param);
+
+/**
+ * @brief Converts a point cloud message with the colors of its color field.
+ *
+ * Positions and colors are decoded in one pass over the message. Downsampled points get the
+ * average color of the points they replace.
+ *
+ * @param msg The point cloud message.
+ * @param param The conversion parameters.
+ * @return MeshArrays The converted points in vertices and, if the color field was found, their
+ * colors. Empty if the transform failed.
+ */
+MeshArrays convert_pointcloud_arrays(
+  const sensor_msgs::msg::PointCloud2 & msg, const PointCloudConversionParam & param);
+
+/**
+ * @brief Replaces the points in each occupied voxel by their centroid.
+ *
+ * @param pointcloud The input points.
+ * @param voxel_size Leaf size of the voxel grid.
+ * @return PackedVector3Array One point per occupied voxel, in order of first occurrence.
+ */
+PackedVector3Array downsample_voxel_grid(
+  const PackedVector3Array & pointcloud, const float voxel_size);
+
+/**
+ * @brief Hashes the layout and the data of a point cloud message for the disk cache.
+ *
+ * The header stamp is left out, so a map republished with a new stamp still hits the cache.
+ *
+ * @param msg The point cloud message.
+ * @return uint64_t The hash.
+ */
+uint64_t hash_pointcloud(const sensor_msgs::msg::PointCloud2 & msg);
+
 /**
  * @class PointCloud
  * @brief The PointCloud class provides an interface to process and retrieve data from PointCloud2
@@ -39,13 +118,107 @@ public:
   /**
    * @brief Retrieves the point cloud data, optionally transforming it to a specified frame.
    *
+   * Never waits for TF: if the transform of the latest message is not available yet, an empty
+   * array is returned and the conversion is retried on the next call.
+   *
    * @param frame_id The target frame ID to which the point cloud should be transformed. Defaults to
    * "map".
    * @return PackedVector3Array A Godot array containing the point cloud data.
    */
   PackedVector3Array get_pointcloud(const String & frame_id = "map");
 
-  PointCloud() = default;
+  /**
+   * @brief Retrieves the point cloud with the colors of the color field as Mesh arrays.
+   *
+   * The result can be passed to add_surface_from_arrays with PRIMITIVE_POINTS. ARRAY_COLOR is
+   * only set if color_field is set and present in the message.
+   *
+   * @param frame_id The target frame ID, as in get_pointcloud.
+   * @return Array An Array of Mesh::ARRAY_MAX elements.
+   */
+  Array get_pointcloud_arrays(const String & frame_id = "map");
+
+  /**
+   * @brief Converts every received message in the subscription callback instead of in the getter.
+   *
+   * get_pointcloud then returns the prepared array when it is called with the same frame ID. A
+   * message whose transform to the frame has not arrived yet is held back until it does, so
+   * has_new only reports messages that can be converted. Messages whose transform does not arrive
+   * within 0.5 s are dropped.
+   *
+   * @param frame_id The target frame ID passed to get_pointcloud.
+   */
+  void enable_precompute(const String & frame_id = "map");
+
+  /**
+   * @brief Stops converting messages in the subscription callback.
+   */
+  void disable_precompute();
+
+  /**
+   * @brief Sets the number of points converted per task on Godot's WorkerThreadPool.
+   *
+   * Large clouds are split into chunks of this size and converted in parallel into disjoint ranges
+   * of the output array. 0 disables parallel conversion.
+   *
+   * @param chunk_size Number of points per task.
+   */
+  void set_chunk_size(const int chunk_size);
+  int get_chunk_size() const { return chunk_size_; }
+
+  /**
+   * @brief Sets the leaf size of the voxel grid filter applied after conversion.
+   *
+   * Points falling into the same voxel are replaced by their centroid.
+   *
+   * @param voxel_size Leaf size in meters. 0 disables the filter.
+   */
+  void set_voxel_size(const float voxel_size);
+  float get_voxel_size() const { return voxel_size_; }
+
+  /**
+   * @brief Sets the maximum number of points returned by get_pointcloud.
+   *
+   * Clouds exceeding the budget after the voxel grid filter are subsampled with a uniform stride.
+   *
+   * @param max_points Point budget. 0 means no limit.
+   */
+  void set_max_points(const int max_points);
+  int get_max_points() const { return max_points_; }
+
+  /**
+   * @brief Sets the point field that colors the points returned by get_pointcloud_arrays.
+   *
+   * "rgb" and "rgba" are decoded as packed 8-bit colors. "z" colors by the height in the target
+   * frame. Any other field, e.g. "intensity" or "ring", is mapped through a rainbow colormap from
+   * blue at the low end of color_range to red at the high end.
+   *
+   * @param field Field name. Empty disables coloring.
+   */
+  void set_color_field(const String & field);
+  String get_color_field() const { return color_field_; }
+
+  /**
+   * @brief Sets the field values mapped to the ends of the colormap.
+   *
+   * @param range Minimum in x and maximum in y. If x >= y, the range of each message is used.
+   */
+  void set_color_range(const Vector2 & range);
+  Vector2 get_color_range() const { return color_range_; }
+
+  /**
+   * @brief Enables the on-disk cache of converted point clouds.
+   *
+   * Converted arrays are stored under user:// keyed by a hash of the message and the conversion
+   * parameters, so a map received again in the next session is loaded instead of converted. Only
+   * meant for static clouds, since the transform to the target frame is not part of the key.
+   *
+   * @param enabled Whether to use the cache.
+   */
+  void set_disk_cache(const bool enabled);
+  bool is_disk_cache_enabled() const { return disk_cache_->is_enabled(); }
+
+  PointCloud();
   ~PointCloud() = default;
 
 protected:
@@ -53,4 +226,37 @@ protected:
    * @brief Binds methods to the Godot system.
    */
   static void _bind_methods();
+
+private:
+  std::shared_ptr<DiskCache> disk_cache_;
+  std::shared_ptr<TfMessageFilter> tf_filter_;
+  using PointCloudPrecompute =
+    Precompute<sensor_msgs::msg::PointCloud2, PointCloudConversionParam, MeshArrays>;
+  std::shared_ptr<PointCloudPrecompute> precompute_;
+  int chunk_size_ = 65536;
+  float voxel_size_ = 0.0;
+  int max_points_ = 0;
+  String color_field_;
+  Vector2 color_range_;
+
+  // Result of the last conversion done by get_pointcloud, reused while message and parameters match
+  ConstSharedPtr cached_msg_;
+  PointCloudConversionParam cached_param_;
+  MeshArrays cached_pointcloud_;
+
+  /**
+   * @brief Creates the conversion parameters from the given frame ID and the current properties.
+   */
+  PointCloudConversionParam make_param(const String & frame_id) const;
+
+  /**
+   * @brief Gets the converted arrays of the latest message, from the precomputed or cached result
+   * if it matches.
+   */
+  MeshArrays get_latest_arrays(const String & frame_id);
+
+  /**
+   * @brief Applies the current properties to the following precomputed conversions.
+   */
+  void update_precompute();
 };
@@ -0,0 +1,151 @@
+//
+//  Copyright 2022 Yukihiro Saito. All rights reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#pragma once
+
+#include "core/math/aabb.h"
+#include "core/object/ref_counted.h"
+#include "core/string/ustring.h"
+#include "core/variant/variant.h"
+#include "disk_cache.hpp"
+#include "pointcloud.hpp"
+#include "precompute.hpp"
+#include "topic_subscriber.hpp"
+
+#include "sensor_msgs/msg/point_cloud2.hpp"
+
+#include <memory>
+#include <vector>
+
+/**
+ * @brief Parameters used to split a point cloud map into tiles.
+ */
+struct PointCloudMapParam
+{
+  // Target frame ID
+  String frame_id;
+  // Edge length of a square tile in meters
+  float tile_size = 0.0;
+  // Voxel grid leaf size of each LOD level. 0 keeps every point.
+  PackedFloat32Array lod_voxel_sizes;
+  // Points converted per worker task, see PointCloudConversionParam
+  int chunk_size = 0;
+
+  bool operator==(const PointCloudMapParam & other) const
+  {
+    return frame_id == other.frame_id && tile_size == other.tile_size &&
+           lod_voxel_sizes == other.lod_voxel_sizes && chunk_size == other.chunk_size;
+  }
+};
+
+/**
+ * @brief A tile of the point cloud map with its points at every LOD level.
+ */
+struct PointCloudMapTile
+{
+  // Tile index on the horizontal (x, z) plane of Godot's coordinate system
+  Vector2i key;
+  AABB aabb;
+  std::vector<PackedVector3Array> lods;
+};
+
+/**
+ * @class PointCloudMap
+ * @brief The PointCloudMap class splits a static point cloud map into tiles with LOD levels.
+ *
+ * The tiles are built once in the subscription callback when the map is received. get_tiles
+ * then returns only the tiles near a position, each at the LOD level selected by its distance, so
+ * scripts can keep one mesh per tile and upload a tile again only when its LOD level changes.
+ */
+class PointCloudMap : public RefCounted
+{
+  GDCLASS(PointCloudMap, RefCounted);
+  TOPIC_SUBSCRIBER(PointCloudMap, sensor_msgs::msg::PointCloud2);
+
+public:
+  /**
+   * @brief Retrieves the tiles near a position.
+   *
+   * Tile i is returned at the first LOD level whose distance in lod_distances is larger than the
+   * horizontal distance between the position and the tile. Tiles beyond the last distance are
+   * omitted.
+   *
+   * @param position Position in Godot's coordinate system, usually the ego position.
+   * @return Array of Dictionaries with "key" (Vector2i), "lod" (int), "aabb" (AABB) and "points"
+   * (PackedVector3Array).
+   */
+  Array get_tiles(const Vector3 & position);
+
+  /**
+   * @brief Gets the number of tiles of the latest map.
+   */
+  int get_tile_count();
+
+  void set_frame_id(const String & frame_id);
+  String get_frame_id() const { return frame_id_; }
+  void set_tile_size(const float tile_size);
+  float get_tile_size() const { return tile_size_; }
+  void set_lod_voxel_sizes(const PackedFloat32Array & lod_voxel_sizes);
+  PackedFloat32Array get_lod_voxel_sizes() const { return lod_voxel_sizes_; }
+  void set_lod_distances(const PackedFloat32Array & lod_distances);
+  PackedFloat32Array get_lod_distances() const { return lod_distances_; }
+
+  /**
+   * @brief Enables the on-disk cache of the tiles, see PointCloud::set_disk_cache.
+   */
+  void set_disk_cache(const bool enabled);
+  bool is_disk_cache_enabled() const { return disk_cache_->is_enabled(); }
+
+  PointCloudMap();
+  ~PointCloudMap() = default;
+
+protected:
+  /**
+   * @brief Binds methods to the Godot system.
+   */
+  static void _bind_methods();
+
+private:
+  std::shared_ptr<DiskCache> disk_cache_;
+  using TilesPrecompute = Precompute<
+    sensor_msgs::msg::PointCloud2, PointCloudMapParam, std::vector<PointCloudMapTile>>;
+  std::shared_ptr<TilesPrecompute> precompute_;
+
+  String frame_id_ = "map";
+  float tile_size_ = 50.0;
+  PackedFloat32Array lod_voxel_sizes_;
+  PackedFloat32Array lod_distances_;
+
+  // Tiles built by the getter when no precomputed tiles match, reused for the same message
+  ConstSharedPtr cached_msg_;
+  PointCloudMapParam cached_param_;
+  std::shared_ptr<const std::vector<PointCloudMapTile>> cached_tiles_;
+
+  /**
+   * @brief Creates the tiling parameters from the current properties.
+   */
+  PointCloudMapParam make_param() const;
+
+  /**
+   * @brief Gets the tiles of the latest message, building them if necessary.
+   *
+   * The pointer keeps the tiles alive while the executor publishes newer ones.
+   *
+   * @return nullptr if there is no message or its transform to frame_id is not available yet, in
+   * which case the next call tries again.
+   */
+  std::shared_ptr<const std::vector<PointCloudMapTile>> get_latest_tiles();
+};
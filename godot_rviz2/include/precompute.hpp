@@ -0,0 +1,112 @@
+//
+//  Copyright 2022 Yukihiro Saito. All rights reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#pragma once
+
+#include "latest_message.hpp"
+
+#include <functional>
+#include <memory>
+#include <utility>
+
+/**
+ * @class Precompute
+ * @brief Converts each received message into Godot-ready buffers inside the subscription callback.
+ *
+ * When enabled, on_message() runs the converter with the enabled parameters as soon as a message
+ * arrives and publishes the result through a LatestMessage slot. With the background executor this
+ * happens on an executor thread, so the getter on the main thread only has to return the result.
+ *
+ * @tparam MsgT ROS 2 message type.
+ * @tparam ParamT Getter parameters the result was built with.
+ * @tparam ResultT Converted result.
+ */
+template <class MsgT, class ParamT, class ResultT>
+class Precompute
+{
+public:
+  using ConstSharedPtr = typename MsgT::ConstSharedPtr;
+  using Converter = std::function<ResultT(const MsgT &, const ParamT &)>;
+
+  /**
+   * @brief A converted result together with the message and parameters it was built from.
+   */
+  struct Entry
+  {
+    ConstSharedPtr source;
+    ParamT param;
+    ResultT result;
+  };
+
+  explicit Precompute(Converter converter) : converter_(std::move(converter)) {}
+
+  /**
+   * @brief Enables precomputation for the following messages. Called from the main thread.
+   *
+   * @param param Parameters passed to the converter.
+   */
+  void enable(const ParamT & param)
+  {
+    std::atomic_store(&param_, std::make_shared<const ParamT>(param));
+  }
+
+  /**
+   * @brief Disables precomputation. Called from the main thread.
+   */
+  void disable() { std::atomic_store(&param_, std::shared_ptr<const ParamT>()); }
+
+  /**
+   * @brief Checks whether precomputation is enabled.
+   */
+  bool is_enabled() const { return static_cast<bool>(std::atomic_load(&param_)); }
+
+  /**
+   * @brief Gets the enabled parameters.
+   *
+   * @return std::shared_ptr<const ParamT> The parameters, or nullptr if disabled.
+   */
+  std::shared_ptr<const ParamT> get_param() const { return std::atomic_load(&param_); }
+
+  /**
+   * @brief Converts a received message. Called from the subscription callback.
+   *
+   * @param msg The received message.
+   */
+  void on_message(const ConstSharedPtr & msg)
+  {
+    const auto param = std::atomic_load(&param_);
+    if (!param) return;
+    entries_.set(std::make_shared<const Entry>(Entry{msg, *param, converter_(*msg, *param)}));
+  }
+
+  /**
+   * @brief Gets the precomputed entry built from the given message. Called from the main thread.
+   *
+   * @param msg The message the getter is about to convert.
+   * @return std::shared_ptr<const Entry> The entry, or nullptr if it was not built from msg.
+   */
+  std::shared_ptr<const Entry> get(const ConstSharedPtr & msg)
+  {
+    auto entry = entries_.get();
+    if (!entry || entry->source != msg) return nullptr;
+    return entry;
+  }
+
+private:
+  Converter converter_;
+  std::shared_ptr<const ParamT> param_;
+  LatestMessage<Entry> entries_;
+};
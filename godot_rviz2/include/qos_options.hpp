@@ -0,0 +1,54 @@
+//
+//  Copyright 2022 Yukihiro Saito. All rights reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#pragma once
+
+#include "core/variant/dictionary.h"
+#include "rclcpp/rclcpp.hpp"
+
+/**
+ * @brief Builds a QoS profile from a Dictionary, keeping the defaults for missing keys.
+ *
+ * Recognized keys:
+ * - "history": "keep_last" or "keep_all".
+ * - "depth": Queue depth for keep_last.
+ * - "reliability": "reliable" or "best_effort".
+ * - "durability": "volatile" or "transient_local".
+ *
+ * Unknown keys and values are ignored.
+ *
+ * @param options The Dictionary, typically written in GDScript.
+ * @param qos The default profile.
+ * @return rclcpp::QoS The profile.
+ */
+rclcpp::QoS make_qos(const Dictionary & options, rclcpp::QoS qos);
+
+/**
+ * @brief Builds subscription options from a Dictionary.
+ *
+ * Recognized keys:
+ * - "use_intra_process_comms": Receive messages from publishers in the same process without
+ *   serialization. Requires keep_last history and volatile durability: with any other QoS, an
+ *   error is logged and intra-process delivery stays disabled.
+ *
+ * Loaned messages are not supported, since the subscribers keep messages after the callback.
+ *
+ * @param options The Dictionary.
+ * @param qos The profile the subscription is created with.
+ * @return rclcpp::SubscriptionOptions The options, without a callback group.
+ */
+rclcpp::SubscriptionOptions make_subscription_options(
+  const Dictionary & options, const rclcpp::QoS & qos);
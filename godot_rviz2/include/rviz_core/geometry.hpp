@@ -0,0 +1,145 @@
+//
+//  Copyright 2022 Yukihiro Saito. All rights reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#pragma once
+
+#include "rviz_core/mesh_buffers.hpp"
+
+#include "geometry_msgs/msg/polygon.hpp"
+
+#include <cstdint>
+#include <vector>
+
+#define EIGEN_MPL2_ONLY
+#include <eigen3/Eigen/Core>
+#include <eigen3/Eigen/Geometry>
+
+namespace rviz_core
+{
+/**
+ * @brief Converts ROS 2 coordinates to Godot's coordinate system (x, z, -y).
+ */
+inline Eigen::Vector3f ros2_to_godot(const float x, const float y, const float z)
+{
+  return Eigen::Vector3f(x, z, -y);
+}
+
+inline Eigen::Vector3f ros2_to_godot(const Eigen::Vector3f & p)
+{
+  return ros2_to_godot(p.x(), p.y(), p.z());
+}
+
+/**
+ * @brief Calculates the cross product of two Eigen::Vector3f vectors.
+ *
+ * @param a The first vector.
+ * @param b The second vector.
+ * @return Eigen::Vector3f The cross product.
+ */
+Eigen::Vector3f cross_product(const Eigen::Vector3f & a, const Eigen::Vector3f & b);
+
+/**
+ * @brief Generates a 3D bounding box as triangles with one vertex per corner of each triangle.
+ *
+ * The output buffers are replaced.
+ *
+ * @param width The width of the bounding box.
+ * @param height The height of the bounding box.
+ * @param length The length of the bounding box.
+ * @param translation The translation component of the bounding box's transformation.
+ * @param quaternion The rotation component of the bounding box's transformation.
+ * @param mesh Output buffers, in Godot's axes.
+ */
+void generate_boundingbox3d(
+  float width, float height, float length, const Eigen::Translation3f & translation,
+  const Eigen::Quaternionf & quaternion, MeshBuffers & mesh);
+
+/**
+ * @brief Generates a 3D cylinder, see generate_boundingbox3d.
+ *
+ * @param radius The radius of the cylinder.
+ * @param height The height of the cylinder.
+ * @param translation The translation component of the cylinder's transformation.
+ * @param quaternion The rotation component of the cylinder's transformation.
+ * @param mesh Output buffers, in Godot's axes.
+ */
+void generate_cylinder3d(
+  float radius, float height, const Eigen::Translation3f & translation,
+  const Eigen::Quaternionf & quaternion, MeshBuffers & mesh);
+
+/**
+ * @brief Generates a 3D polygon from a clockwise 2D polygon and a height, see
+ * generate_boundingbox3d.
+ *
+ * @param polygon_2d The 2D polygon to extrude.
+ * @param height The height of the extrusion.
+ * @param translation The translation component of the polygon's transformation.
+ * @param quaternion The rotation component of the polygon's transformation.
+ * @param mesh Output buffers, in Godot's axes.
+ */
+void generate_polygon3d(
+  const geometry_msgs::msg::Polygon & polygon_2d, float height,
+  const Eigen::Translation3f & translation, const Eigen::Quaternionf & quaternion,
+  MeshBuffers & mesh);
+
+/**
+ * @brief Overload of generate_polygon3d for a vector of points.
+ */
+void generate_polygon3d(
+  const std::vector<Eigen::Vector2f> & polygon_2d, float height,
+  const Eigen::Translation3f & translation, const Eigen::Quaternionf & quaternion,
+  MeshBuffers & mesh);
+
+/**
+ * @brief Generates a 3D bounding box as indexed triangles.
+ *
+ * Unlike generate_boundingbox3d, the output buffers are appended to, so several primitives can be
+ * collected into one buffer. Indices count from the first vertex of the buffers.
+ *
+ * @param width The width of the bounding box.
+ * @param height The height of the bounding box.
+ * @param length The length of the bounding box.
+ * @param translation The translation component of the bounding box's transformation.
+ * @param quaternion The rotation component of the bounding box's transformation.
+ * @param mesh Buffers the vertices, normals and indices are appended to, in Godot's axes.
+ */
+void generate_boundingbox3d_indexed(
+  float width, float height, float length, const Eigen::Translation3f & translation,
+  const Eigen::Quaternionf & quaternion, MeshBuffers & mesh);
+
+/**
+ * @brief Generates a 3D cylinder as indexed triangles, see generate_boundingbox3d_indexed.
+ */
+void generate_cylinder3d_indexed(
+  float radius, float height, const Eigen::Translation3f & translation,
+  const Eigen::Quaternionf & quaternion, MeshBuffers & mesh);
+
+/**
+ * @brief Generates a 3D polygon as indexed triangles, see generate_boundingbox3d_indexed.
+ */
+void generate_polygon3d_indexed(
+  const geometry_msgs::msg::Polygon & polygon_2d, float height,
+  const Eigen::Translation3f & translation, const Eigen::Quaternionf & quaternion,
+  MeshBuffers & mesh);
+
+/**
+ * @brief Overload of generate_polygon3d_indexed for a vector of points.
+ */
+void generate_polygon3d_indexed(
+  const std::vector<Eigen::Vector2f> & polygon_2d, float height,
+  const Eigen::Translation3f & translation, const Eigen::Quaternionf & quaternion,
+  MeshBuffers & mesh);
+}  // namespace rviz_core
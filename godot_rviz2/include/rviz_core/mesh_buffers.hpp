@@ -0,0 +1,107 @@
+//
+//  Copyright 2022 Yukihiro Saito. All rights reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#define EIGEN_MPL2_ONLY
+#include <eigen3/Eigen/Core>
+
+namespace rviz_core
+{
+/**
+ * @brief Reserves room for additional elements, at least doubling the capacity when it grows.
+ *
+ * std::vector::reserve allocates exactly the requested size, so reserving before each of many
+ * small appends to one buffer would copy the whole buffer every time.
+ */
+template <class T>
+void reserve_additional(std::vector<T> & buffer, const size_t count)
+{
+  const size_t required = buffer.size() + count;
+  if (required > buffer.capacity()) buffer.reserve(std::max(required, 2 * buffer.capacity()));
+}
+
+/**
+ * @brief Mesh channels as plain float buffers, one buffer per channel.
+ *
+ * Coordinates are in Godot's axes, so the binding layer only copies the buffers into packed
+ * arrays, see MeshArrays::from_buffers. Nothing here depends on Godot, so buffers can be built on
+ * any thread and outside the engine.
+ */
+struct MeshBuffers
+{
+  // x, y, z of each vertex
+  std::vector<float> vertices;
+  // x, y, z of each vertex normal
+  std::vector<float> normals;
+  // r, g, b, a of each vertex. Empty if the mesh has no vertex colors.
+  std::vector<float> colors;
+  // One velocity per vertex. Empty if the mesh has no velocities.
+  std::vector<float> velocities;
+  // Triangle indices. Empty for non-indexed geometry.
+  std::vector<int32_t> indices;
+
+  /**
+   * @brief Gets the number of vertices.
+   */
+  size_t size() const { return vertices.size() / 3; }
+
+  /**
+   * @brief Reserves room for a number of additional vertices with normals, see reserve_additional.
+   */
+  void reserve(const size_t num_vertices)
+  {
+    reserve_additional(vertices, 3 * num_vertices);
+    reserve_additional(normals, 3 * num_vertices);
+  }
+
+  /**
+   * @brief Appends a vertex with its normal, both in Godot's axes.
+   */
+  void append(const Eigen::Vector3f & vertex, const Eigen::Vector3f & normal)
+  {
+    vertices.insert(vertices.end(), {vertex.x(), vertex.y(), vertex.z()});
+    normals.insert(normals.end(), {normal.x(), normal.y(), normal.z()});
+  }
+
+  /**
+   * @brief Drops every vertex from the given one on, with the channels that are set.
+   *
+   * Meant for non-indexed geometry such as strips.
+   */
+  void truncate(const size_t num_vertices)
+  {
+    if (num_vertices >= size()) return;
+    vertices.resize(3 * num_vertices);
+    normals.resize(3 * num_vertices);
+    if (!colors.empty()) colors.resize(4 * num_vertices);
+    if (!velocities.empty()) velocities.resize(num_vertices);
+  }
+
+  /**
+   * @brief Appends the color of the last vertex.
+   */
+  void append_color(const float r, const float g, const float b, const float a)
+  {
+    colors.insert(colors.end(), {r, g, b, a});
+  }
+};
+}  // namespace rviz_core
@@ -0,0 +1,237 @@
+//
+//  Copyright 2022 Yukihiro Saito. All rights reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#pragma once
+
+#include "rviz_core/mesh_buffers.hpp"
+
+#include "geometry_msgs/msg/point.hpp"
+#include "geometry_msgs/msg/pose.hpp"
+
+#include <algorithm>
+#include <array>
+#include <vector>
+
+#define EIGEN_MPL2_ONLY
+#include <eigen3/Eigen/Core>
+#include <eigen3/Eigen/Geometry>
+
+namespace rviz_core
+{
+/**
+ * @brief Appends the left and right vertex of a strip point.
+ *
+ * The basis is computed once per point and shared by both offsets: the vertices are offset along
+ * its y axis, and its z axis is their normal.
+ *
+ * @param triangle_strip Triangle strip the positions and normals are appended to, in Godot's axes
+ * @param basis Rotation matrix of the point's orientation
+ * @param position Position vector
+ * @param half_width Offset of each vertex from the position
+ */
+void append_strip_pair(
+  MeshBuffers & triangle_strip, const Eigen::Matrix3f & basis, const Eigen::Vector3f & position,
+  const float half_width);
+
+/**
+ * @brief What a point of a pose strip is generated from: position, orientation and velocity.
+ *
+ * Stored in single precision like the generated vertices, so equal keys generate equal vertices.
+ */
+struct PoseStripPoint
+{
+  std::array<float, 8> values;
+
+  template <class PointT>
+  static PoseStripPoint from_point(const PointT & point)
+  {
+    const auto & position = point.pose.position;
+    const auto & orientation = point.pose.orientation;
+    return PoseStripPoint{
+      {static_cast<float>(position.x), static_cast<float>(position.y),
+       static_cast<float>(position.z), static_cast<float>(orientation.x),
+       static_cast<float>(orientation.y), static_cast<float>(orientation.z),
+       static_cast<float>(orientation.w), static_cast<float>(point.longitudinal_velocity_mps)}};
+  }
+
+  bool operator==(const PoseStripPoint & other) const { return values == other.values; }
+  bool operator!=(const PoseStripPoint & other) const { return values != other.values; }
+};
+
+/**
+ * @brief Appends the two vertices of a pose strip point with their velocities.
+ */
+void append_pose_strip_point(
+  MeshBuffers & triangle_strip, const PoseStripPoint & point, const float width);
+
+/**
+ * @brief Generates a triangle strip of a given width along the poses of trajectory or path points.
+ *
+ * @tparam PointT A point with a pose and a longitudinal_velocity_mps, e.g. TrajectoryPoint or
+ * PathPoint.
+ * @param points The points of the strip.
+ * @param width The width of the strip.
+ * @return MeshBuffers Two vertices per point with normals and velocities.
+ */
+template <class PointT>
+MeshBuffers generate_pose_strip(const std::vector<PointT> & points, const float width)
+{
+  MeshBuffers triangle_strip;
+  triangle_strip.reserve(2 * points.size());
+  triangle_strip.velocities.reserve(2 * points.size());
+  for (const auto & point : points) {
+    append_pose_strip_point(triangle_strip, PoseStripPoint::from_point(point), width);
+  }
+  return triangle_strip;
+}
+
+/**
+ * @class PoseStripBuilder
+ * @brief Keeps the pose strip of the last points and regenerates only what changed.
+ *
+ * Planning republishes the same or mostly the same trajectory at a high rate. The points are
+ * compared with the previous ones, the vertices of the unchanged prefix are kept and only the tail
+ * from the first changed point on is generated again.
+ */
+class PoseStripBuilder
+{
+public:
+  /**
+   * @brief Updates the strip to the given points.
+   *
+   * @param points The points of the strip, see generate_pose_strip.
+   * @param width The width of the strip. A different width regenerates every point.
+   * @return bool Whether the strip changed.
+   */
+  template <class PointT>
+  bool update(const std::vector<PointT> & points, const float width)
+  {
+    if (width != width_) {
+      clear();
+      width_ = width;
+    }
+
+    // Find the first point that differs from the previous update
+    const size_t common = std::min(points.size(), points_.size());
+    size_t prefix = 0;
+    while (prefix < common && points_[prefix] == PoseStripPoint::from_point(points[prefix])) {
+      ++prefix;
+    }
+    if (prefix == points.size() && prefix == points_.size()) return false;
+
+    // Keep the vertices of the prefix and regenerate the tail
+    points_.resize(prefix);
+    strip_.truncate(2 * prefix);
+    strip_.reserve(2 * (points.size() - prefix));
+    for (size_t i = prefix; i < points.size(); ++i) {
+      points_.push_back(PoseStripPoint::from_point(points[i]));
+      append_pose_strip_point(strip_, points_.back(), width);
+    }
+    reused_points_ = prefix;
+    return true;
+  }
+
+  /**
+   * @brief Gets the strip of the last update.
+   */
+  const MeshBuffers & get_strip() const { return strip_; }
+
+  /**
+   * @brief Gets the number of points whose vertices the last changing update kept.
+   */
+  size_t get_reused_points() const { return reused_points_; }
+
+  /**
+   * @brief Drops the kept strip, so the next update generates every point.
+   */
+  void clear();
+
+private:
+  std::vector<PoseStripPoint> points_;
+  MeshBuffers strip_;
+  float width_ = 0.0;
+  size_t reused_points_ = 0;
+};
+
+/**
+ * @brief Generates a triangle strip of a given width along a line without orientations.
+ *
+ * The strip is oriented along the bisector of the adjacent segments.
+ *
+ * @param line The points of the line. At least two are needed.
+ * @param width The width of the strip.
+ * @param miter Whether to lengthen the offsets at corners, see LineStripBuilder::update.
+ * @return MeshBuffers Two vertices per point with normals.
+ */
+MeshBuffers generate_line_strip(
+  const std::vector<geometry_msgs::msg::Point> & line, float width, const bool miter = false);
+
+/**
+ * @class LineStripBuilder
+ * @brief Keeps the line strip of the last line and regenerates only what changed.
+ *
+ * Works like PoseStripBuilder. Since the orientation of a point depends on its neighbours, the
+ * point before the first changed one is regenerated too.
+ */
+class LineStripBuilder
+{
+public:
+  /**
+   * @brief Updates the strip to the given line.
+   *
+   * @param line The points of the line. With less than two points the strip is empty.
+   * @param width The width of the strip. A different width regenerates every point.
+   * @param miter Whether to lengthen the offsets at corners so the strip keeps its width along
+   * both adjacent segments, up to four times the half width at sharp corners. Otherwise the
+   * offsets keep half the width and the strip narrows at corners.
+   * @return bool Whether the strip changed.
+   */
+  bool update(
+    const std::vector<geometry_msgs::msg::Point> & line, const float width,
+    const bool miter = false);
+
+  /**
+   * @brief Gets the strip of the last update.
+   */
+  const MeshBuffers & get_strip() const { return strip_; }
+
+  /**
+   * @brief Drops the kept strip, so the next update generates every point.
+   */
+  void clear();
+
+private:
+  std::vector<Eigen::Vector3f> points_;
+  MeshBuffers strip_;
+  float width_ = 0.0;
+  bool miter_ = false;
+};
+
+/**
+ * @brief Generates a vertical wall across a pose as a triangle strip.
+ *
+ * The base is opaque red and the top fades out.
+ *
+ * @param pose The pose the wall is placed at.
+ * @param width The width of the wall.
+ * @param height The height of the wall.
+ * @param length_offset Offset of the wall along the x axis of the pose.
+ * @return MeshBuffers Four vertices with normals and colors.
+ */
+MeshBuffers generate_wall_strip(
+  const geometry_msgs::msg::Pose & pose, const float width, const float height,
+  const float length_offset);
+}  // namespace rviz_core
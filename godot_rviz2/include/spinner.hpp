@@ -25,7 +25,8 @@
  * Godot environment.
  *
  * This class provides a method to spin the ROS 2 node, allowing callbacks to be processed. It is
- * designed to integrate ROS 2 node activity within a Godot application.
+ * designed to integrate ROS 2 node activity within a Godot application. Callbacks can either be
+ * processed on the calling thread with spin_some, or on a background executor started with start.
  */
 class GodotRviz2Spinner : public RefCounted
 {
@@ -39,9 +40,36 @@ public:
    * @brief Spins the ROS 2 node to process callbacks.
    *
    * This method invokes rclcpp::spin_some, allowing the ROS 2 node to handle incoming messages and
-   * service requests.
+   * service requests. It does nothing while the background executor is running.
    */
-  inline void spin_some() { rclcpp::spin_some(GodotRviz2::get_instance().get_node()); }
+  inline void spin_some()
+  {
+    if (GodotRviz2::get_instance().is_executor_running()) return;
+    rclcpp::spin_some(GodotRviz2::get_instance().get_node());
+  }
+
+  /**
+   * @brief Starts processing callbacks on a background MultiThreadedExecutor.
+   *
+   * @param num_threads Number of executor threads. 0 uses the number of hardware threads.
+   * @return bool True if the executor was started, false if it was already running.
+   */
+  inline bool start(const int num_threads = 0)
+  {
+    return GodotRviz2::get_instance().start_executor(num_threads);
+  }
+
+  /**
+   * @brief Stops the background executor. spin_some can be used again afterwards.
+   */
+  inline void stop() { GodotRviz2::get_instance().stop_executor(); }
+
+  /**
+   * @brief Checks whether callbacks are processed on the background executor.
+   *
+   * @return bool True if the background executor is running.
+   */
+  inline bool is_running() { return GodotRviz2::get_instance().is_executor_running(); }
 
 protected:
   /**
@@ -0,0 +1,53 @@
+//
+//  Copyright 2022 Yukihiro Saito. All rights reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#pragma once
+
+#include "mesh_arrays.hpp"
+#include "rviz_core/strip.hpp"
+
+/**
+ * @class StripCache
+ * @brief Pairs a strip builder of the core with the packed arrays of its last strip.
+ *
+ * The arrays are rebuilt only when the builder reports a change, so a republished identical
+ * message returns the previous arrays, which Godot shares instead of copying. Not thread-safe:
+ * each instance belongs to one thread.
+ *
+ * @tparam BuilderT rviz_core::PoseStripBuilder or rviz_core::LineStripBuilder.
+ */
+template <class BuilderT>
+class StripCache
+{
+public:
+  /**
+   * @brief Updates the strip to the given points.
+   *
+   * @param points The points passed to the builder.
+   * @param args The width of the strip and further options of the builder.
+   * @return const MeshArrays & The strip channels.
+   */
+  template <class PointsT, class... Args>
+  const MeshArrays & update(const PointsT & points, const Args &... args)
+  {
+    if (builder_.update(points, args...)) arrays_ = MeshArrays::from_buffers(builder_.get_strip());
+    return arrays_;
+  }
+
+private:
+  BuilderT builder_;
+  MeshArrays arrays_;
+};
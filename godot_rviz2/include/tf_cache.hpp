@@ -0,0 +1,102 @@
+//
+//  Copyright 2022 Yukihiro Saito. All rights reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#pragma once
+
+#include "rclcpp/rclcpp.hpp"
+
+#include "geometry_msgs/msg/transform.hpp"
+#include "geometry_msgs/msg/transform_stamped.hpp"
+
+#include <tf2_ros/buffer.h>
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+/**
+ * @class TfCache
+ * @brief The TfCache class memoizes TF2 lookups for the duration of one Godot frame.
+ *
+ * The first lookup of a (source, target, stamp) triple in a frame goes to the TF2 buffer, repeat
+ * lookups in the same frame are served from a hash map. Failed lookups are cached as well, so a
+ * missing transform costs one TF2 query per frame rather than one per caller. The map is cleared
+ * whenever Godot's process frame counter advances. Safe to use from any thread.
+ */
+class TfCache
+{
+public:
+  /**
+   * @brief Constructor for TfCache.
+   *
+   * @param tf_buffer The TF2 buffer to look transformations up in.
+   */
+  explicit TfCache(std::shared_ptr<tf2_ros::Buffer> tf_buffer) : tf_buffer_(std::move(tf_buffer)) {}
+
+  /**
+   * @brief Retrieves a transformation, from the cache if it was looked up in this frame.
+   *
+   * @param source_frame_id The source frame ID for the transformation.
+   * @param target_frame_id The target frame ID for the transformation.
+   * @param time The specific time at which to retrieve the transformation, 0 for the latest.
+   * @return std::optional<geometry_msgs::msg::Transform> The transformation, if found.
+   */
+  std::optional<geometry_msgs::msg::Transform> lookup(
+    const std::string & source_frame_id, const std::string & target_frame_id,
+    const rclcpp::Time & time);
+
+  /**
+   * @brief Retrieves a transformation with its stamp, see lookup.
+   */
+  std::optional<geometry_msgs::msg::TransformStamped> lookup_stamped(
+    const std::string & source_frame_id, const std::string & target_frame_id,
+    const rclcpp::Time & time);
+
+  /**
+   * @brief Drops every cached transformation.
+   */
+  void clear();
+
+private:
+  struct Key
+  {
+    std::string source_frame_id;
+    std::string target_frame_id;
+    int64_t stamp;
+
+    bool operator==(const Key & other) const
+    {
+      return stamp == other.stamp && source_frame_id == other.source_frame_id &&
+             target_frame_id == other.target_frame_id;
+    }
+  };
+
+  struct KeyHash
+  {
+    size_t operator()(const Key & key) const;
+  };
+
+  std::shared_ptr<tf2_ros::Buffer> tf_buffer_;
+  std::mutex mutex_;
+  // Godot process frame the cached transformations belong to
+  uint64_t frame_ = 0;
+  std::unordered_map<Key, std::optional<geometry_msgs::msg::TransformStamped>, KeyHash>
+    transforms_;
+};
@@ -0,0 +1,108 @@
+//
+//  Copyright 2022 Yukihiro Saito. All rights reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#pragma once
+
+#include "rclcpp/rclcpp.hpp"
+
+#include "std_msgs/msg/header.hpp"
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+/**
+ * @class TfMessageFilter
+ * @brief Passes messages on once their transform to a target frame is available, like
+ * tf2_ros::MessageFilter, without ever blocking the caller.
+ *
+ * A message whose transform is already in the TF2 buffer is passed on immediately. Otherwise the
+ * TF2 buffer notifies the filter when the transform arrives, and the message is passed on from the
+ * worker thread of the filter, so the TF2 listener is not held up by the conversion. Only the
+ * latest message waits: a message still waiting when the next one arrives is dropped, as is one
+ * whose transform does not arrive within the timeout. Messages are passed on one at a time and in
+ * order: one that is overtaken by a newer message while it waits for the publication is dropped.
+ */
+class TfMessageFilter
+{
+public:
+  using Callback = std::function<void()>;
+
+  /**
+   * @brief Constructor for TfMessageFilter.
+   *
+   * @param timeout How long a message waits for its transform before it is dropped.
+   */
+  explicit TfMessageFilter(const rclcpp::Duration & timeout);
+
+  /**
+   * @brief Destructor for TfMessageFilter. Drops the waiting message and joins the worker thread.
+   */
+  ~TfMessageFilter();
+
+  TfMessageFilter(const TfMessageFilter &) = delete;
+  TfMessageFilter & operator=(const TfMessageFilter &) = delete;
+
+  /**
+   * @brief Passes a message on once the transform from its frame to the target frame is available.
+   *
+   * @param target_frame_id The target frame ID.
+   * @param header Header of the message, whose frame and stamp are looked up.
+   * @param on_ready Called with the message once its transform is available.
+   */
+  void add(
+    const std::string & target_frame_id, const std_msgs::msg::Header & header, Callback on_ready);
+
+private:
+  /**
+   * @brief State shared with the TF2 buffer callbacks, which may outlive the filter.
+   */
+  struct State
+  {
+    std::mutex mutex;
+    std::condition_variable condition;
+    // Incremented for every message, so callbacks of dropped messages can tell they are stale
+    uint64_t generation = 0;
+    // Callback of the message whose transform arrived, run by the worker thread
+    Callback ready;
+    // Generation of the message of ready
+    uint64_t ready_generation = 0;
+    bool stop = false;
+    // Held while a callback runs, so the caller thread and the worker never pass messages on at
+    // the same time. Taken before mutex.
+    std::mutex publish_mutex;
+  };
+
+  rclcpp::Duration timeout_;
+  std::shared_ptr<State> state_;
+  // Started on the first message that has to wait
+  std::thread worker_;
+
+  /**
+   * @brief Runs the callbacks of ready messages until the filter is destroyed.
+   */
+  static void run(const std::shared_ptr<State> & state);
+
+  /**
+   * @brief Runs the callback of a message unless a newer message has arrived.
+   */
+  static void publish(
+    const std::shared_ptr<State> & state, const uint64_t generation, const Callback & on_ready);
+};
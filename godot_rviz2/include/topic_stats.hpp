@@ -0,0 +1,216 @@
+//
+//  Copyright 2022 Yukihiro Saito. All rights reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * @class LatencyHistogram
+ * @brief Log-scale histogram of durations with percentile estimates.
+ *
+ * Buckets grow by a factor of 2^(1/4) from 1 us, so a percentile is off by at most 19% and the
+ * histogram takes a fixed 1 KiB regardless of the number of samples. Not thread-safe.
+ */
+class LatencyHistogram
+{
+public:
+  /**
+   * @brief Adds a duration. Negative durations, e.g. from unsynchronized clocks, count as 0.
+   */
+  void record(const double seconds);
+
+  /**
+   * @brief Estimates a percentile.
+   *
+   * @param quantile The quantile in [0, 1], e.g. 0.99 for p99.
+   * @return double The duration in seconds, 0 if nothing was recorded.
+   */
+  double get_percentile(const double quantile) const;
+
+  uint64_t get_count() const { return count_; }
+  double get_mean() const { return count_ > 0 ? sum_ / count_ : 0.0; }
+  double get_max() const { return max_; }
+
+private:
+  static constexpr size_t num_buckets = 128;
+  static constexpr double min_seconds = 1e-6;
+  static constexpr double buckets_per_octave = 4.0;
+
+  std::array<uint64_t, num_buckets> buckets_{};
+  uint64_t count_ = 0;
+  double sum_ = 0.0;
+  double max_ = 0.0;
+};
+
+/**
+ * @class TopicStats
+ * @brief Delivery, consumption and conversion statistics of one subscribed topic.
+ *
+ * The subscription callback records received and published messages, the Godot main thread
+ * records consumed messages and getter timings. Safe to use from any thread.
+ */
+class TopicStats
+{
+public:
+  /**
+   * @brief Summary of a histogram.
+   */
+  struct Percentiles
+  {
+    uint64_t count = 0;
+    double mean = 0.0;
+    double p50 = 0.0;
+    double p99 = 0.0;
+    double max = 0.0;
+  };
+
+  /**
+   * @brief Copy of the statistics at one point in time.
+   */
+  struct Snapshot
+  {
+    std::string topic;
+    // Messages received by the subscription callback
+    uint64_t received = 0;
+    // Received messages held back and never published, e.g. while waiting for TF
+    uint64_t dropped = 0;
+    // Published messages replaced by a newer one before set_old
+    uint64_t overwritten = 0;
+    // Messages marked as consumed by set_old
+    uint64_t consumed = 0;
+    // Receive rate over the recent messages in Hz
+    double rate = 0.0;
+    // From header.stamp to the subscription callback
+    Percentiles delivery_latency;
+    // From header.stamp to set_old, i.e. until the message was rendered
+    Percentiles render_latency;
+    // Duration of each instrumented getter by name
+    std::map<std::string, Percentiles> conversions;
+  };
+
+  /**
+   * @brief Measures the scope it lives in and records it as a conversion.
+   */
+  class ScopedTimer
+  {
+  public:
+    ScopedTimer(std::shared_ptr<TopicStats> stats, const char * name)
+    : stats_(std::move(stats)), name_(name), start_(std::chrono::steady_clock::now())
+    {
+    }
+    ScopedTimer(const ScopedTimer &) = delete;
+    ScopedTimer & operator=(const ScopedTimer &) = delete;
+    ~ScopedTimer()
+    {
+      if (!stats_) return;
+      const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start_;
+      stats_->record_conversion(name_, elapsed.count());
+    }
+
+  private:
+    std::shared_ptr<TopicStats> stats_;
+    const char * name_;
+    std::chrono::steady_clock::time_point start_;
+  };
+
+  explicit TopicStats(std::string topic) : topic_(std::move(topic)) {}
+
+  /**
+   * @brief Records a message entering the subscription callback.
+   *
+   * @param stamp_ns header.stamp in nanoseconds, 0 if the message has none.
+   * @param receive_ns Receive time in nanoseconds, in the clock of the stamps.
+   */
+  void record_receive(const int64_t stamp_ns, const int64_t receive_ns);
+
+  /**
+   * @brief Records a message published to the getters.
+   */
+  void record_publish();
+
+  /**
+   * @brief Records a set_old call.
+   *
+   * @param num_published Messages published since the previous set_old. All but the last one
+   * were overwritten without being consumed.
+   * @param stamp_ns header.stamp of the consumed message in nanoseconds, 0 if it has none.
+   * @param render_ns Current time in nanoseconds, in the clock of the stamps.
+   */
+  void record_consume(
+    const uint64_t num_published, const int64_t stamp_ns, const int64_t render_ns);
+
+  /**
+   * @brief Records the duration of a getter call.
+   */
+  void record_conversion(const std::string & name, const double seconds);
+
+  Snapshot get_snapshot() const;
+  void reset();
+
+private:
+  // Receive times kept for the rate estimate
+  static constexpr size_t rate_window = 32;
+
+  const std::string topic_;
+  mutable std::mutex mutex_;
+  uint64_t received_ = 0;
+  uint64_t published_ = 0;
+  uint64_t overwritten_ = 0;
+  uint64_t consumed_ = 0;
+  std::deque<int64_t> receive_times_;
+  LatencyHistogram delivery_latency_;
+  LatencyHistogram render_latency_;
+  std::map<std::string, LatencyHistogram> conversions_;
+};
+
+/**
+ * @class TopicStatsRegistry
+ * @brief The TopicStatsRegistry class owns the statistics of every subscribed topic.
+ *
+ * Subscribers of the same topic share one TopicStats. Safe to use from any thread.
+ */
+class TopicStatsRegistry
+{
+public:
+  /**
+   * @brief Gets the statistics of a topic, creating them on first use.
+   */
+  std::shared_ptr<TopicStats> get_topic_stats(const std::string & topic);
+
+  /**
+   * @brief Takes a snapshot of every topic, ordered by topic name.
+   */
+  std::vector<TopicStats::Snapshot> get_snapshots() const;
+
+  /**
+   * @brief Clears the statistics of every topic.
+   */
+  void reset();
+
+private:
+  mutable std::mutex mutex_;
+  std::map<std::string, std::shared_ptr<TopicStats>> topics_;
+};
@@ -16,51 +16,182 @@
 
 #pragma once
 
+#include "frame_snapshot.hpp"
 #include "godot_rviz2.hpp"
+#include "latest_message.hpp"
+#include "message_history.hpp"
+#include "qos_options.hpp"
 #include "rclcpp/qos.hpp"
+#include "rosidl_runtime_cpp/traits.hpp"
+#include "topic_stats.hpp"
 #include "util.hpp"
 
 #include "sensor_msgs/msg/point_cloud2.hpp"
 
+#include <algorithm>
+#include <exception>
+#include <functional>
+#include <memory>
 #include <optional>
+#include <utility>
 
 // Because template class cannot work to bind_methods and register_class.
 // https://godotengine.org/qa/136574/how-to-implement-object-using-template-class
 #if 1
-#define TOPIC_SUBSCRIBER(CLASS, TYPE)                                                   \
-private:                                                                                \
-  using ConstSharedPtr = typename TYPE::ConstSharedPtr;                                 \
-  ConstSharedPtr msg_ptr_;                                                              \
-  bool has_new_ = false;                                                                \
-  typename rclcpp::Subscription<TYPE>::SharedPtr subscription_;                         \
-                                                                                        \
-  void on_callback(const ConstSharedPtr msg)                                            \
-  {                                                                                     \
-    msg_ptr_ = msg;                                                                     \
-    has_new_ = true;                                                                    \
-  }                                                                                     \
-  std::optional<ConstSharedPtr> get_last_msg()                                          \
-  {                                                                                     \
-    if (!msg_ptr_) return std::nullopt;                                                 \
-    return msg_ptr_;                                                                    \
-  }                                                                                     \
-                                                                                        \
-public:                                                                                 \
-  bool has_new() { return has_new_; }                                                   \
-  void set_old() { has_new_ = false; }                                                  \
-                                                                                        \
-  void subscribe(const String & topic, const bool transient_local = false)              \
-  {                                                                                     \
-    rclcpp::QoS qos = rclcpp::SensorDataQoS().keep_last(1);                             \
-    if (transient_local) qos = rclcpp::QoS{1}.transient_local();                        \
-    subscription_ = GodotRviz2::get_instance().get_node()->create_subscription<TYPE>(   \
-      to_std(topic), qos, std::bind(&CLASS::on_callback, this, std::placeholders::_1)); \
+#define TOPIC_SUBSCRIBER(CLASS, TYPE)                                                            \
+private:                                                                                         \
+  using ConstSharedPtr = typename TYPE::ConstSharedPtr;                                          \
+  std::shared_ptr<LatestMessage<TYPE>> latest_msg_ = std::make_shared<LatestMessage<TYPE>>();    \
+  /* Recent messages by stamp, empty unless set_history_size was called */                       \
+  std::shared_ptr<MessageHistory<TYPE>> history_ = std::make_shared<MessageHistory<TYPE>>();     \
+  /* Called in the subscription callback before the message is published. Set it in the */       \
+  /* constructor and capture only shared state, since it may outlive the subscriber. */          \
+  std::function<void(const ConstSharedPtr &)> message_hook_;                                     \
+  /* Called in the subscription callback with the message and a function publishing it, */       \
+  /* which runs message_hook_. May defer the publication. Set it like message_hook_. */          \
+  std::function<void(const ConstSharedPtr &, std::function<void()>)> message_gate_;              \
+  rclcpp::CallbackGroup::SharedPtr callback_group_;                                              \
+  typename rclcpp::Subscription<TYPE>::SharedPtr subscription_;                                  \
+  /* Shared with the other subscribers of the topic, nullptr until subscribed */                 \
+  std::shared_ptr<TopicStats> stats_;                                                            \
+  /* Message pinned by the attached FrameSnapshot, nullptr until attach_to_snapshot */           \
+  std::shared_ptr<MessageSnapshot<TYPE>> snapshot_;                                              \
+                                                                                                 \
+  /* Records the duration of a getter until the end of the calling scope */                      \
+  TopicStats::ScopedTimer measure_conversion(const char * name) const                            \
+  {                                                                                              \
+    return TopicStats::ScopedTimer(stats_, name);                                                \
+  }                                                                                              \
+                                                                                                 \
+  bool is_snapshot_attached() const { return snapshot_ && snapshot_->is_attached(); }            \
+                                                                                                 \
+  std::optional<ConstSharedPtr> get_last_msg()                                                   \
+  {                                                                                              \
+    if (is_snapshot_attached() && snapshot_->get_pinned()) return snapshot_->get_pinned();       \
+    ConstSharedPtr msg_ptr = latest_msg_->get();                                                 \
+    if (!msg_ptr) return std::nullopt;                                                           \
+    return msg_ptr;                                                                              \
+  }                                                                                              \
+                                                                                                 \
+  /* Default QoS of subscribe, with enough depth to fill the history when callbacks lag */       \
+  rclcpp::QoS get_default_qos(const bool transient_local) const                                  \
+  {                                                                                              \
+    if (transient_local) return rclcpp::QoS{1}.transient_local();                                \
+    return rclcpp::SensorDataQoS().keep_last(std::max(get_history_size(), 1));                   \
+  }                                                                                              \
+                                                                                                 \
+  void subscribe_with_qos(                                                                       \
+    const String & topic, const rclcpp::QoS & qos, rclcpp::SubscriptionOptions options)          \
+  {                                                                                              \
+    const auto node = GodotRviz2::get_instance().get_node();                                     \
+    /* One group per subscription: topics run in parallel, each one stays sequential */          \
+    callback_group_ = node->create_callback_group(rclcpp::CallbackGroupType::MutuallyExclusive); \
+    options.callback_group = callback_group_;                                                    \
+    stats_ = GodotRviz2::get_instance().get_topic_stats()->get_topic_stats(to_std(topic));       \
+    if (snapshot_) snapshot_->set_stats(stats_);                                                 \
+    try {                                                                                        \
+      subscription_ = node->create_subscription<TYPE>(                                           \
+        to_std(topic), qos,                                                                      \
+        [callback = make_message_callback()](const ConstSharedPtr msg) {                         \
+          /* Messages are kept after the callback, but a loan ends with it. Only plain types */  \
+          /* can be loaned. */                                                                   \
+          if constexpr (rosidl_generator_traits::is_plain<TYPE>::value) {                        \
+            callback(std::make_shared<const TYPE>(*msg));                                        \
+          } else {                                                                               \
+            callback(msg);                                                                       \
+          }                                                                                      \
+        },                                                                                       \
+        options);                                                                                \
+    } catch (const std::exception & ex) {                                                        \
+      /* E.g. an invalid topic name, which would otherwise terminate Godot */                    \
+      RCLCPP_ERROR(                                                                              \
+        node->get_logger(), "Cannot subscribe to %s: %s", to_std(topic).c_str(), ex.what());     \
+      subscription_.reset();                                                                     \
+    }                                                                                            \
+  }                                                                                              \
+                                                                                                 \
+  /* Runs the gate, the hook and the publication of a received message. Captures only shared */  \
+  /* state, since the subscription may outlive the subscriber. */                                \
+  std::function<void(const ConstSharedPtr &)> make_message_callback() const                      \
+  {                                                                                              \
+    return [latest_msg = latest_msg_, history = history_,                                        \
+            clock = GodotRviz2::get_instance().get_node()->get_clock(), stats = stats_,          \
+            message_hook = message_hook_,                                                        \
+            message_gate = message_gate_](const ConstSharedPtr & msg) {                          \
+      if (stats) {                                                                               \
+        stats->record_receive(                                                                   \
+          message_history::get_stamp(*msg, rclcpp::Time()), clock->now().nanoseconds());         \
+      }                                                                                          \
+      auto publish = [latest_msg, history, clock, stats, message_hook, msg]() {                  \
+        if (message_hook) message_hook(msg);                                                     \
+        if (stats) stats->record_publish();                                                      \
+        history->push(msg, clock->now());                                                        \
+        latest_msg->set(msg);                                                                    \
+      };                                                                                         \
+      if (message_gate) {                                                                        \
+        message_gate(msg, std::move(publish));                                                   \
+      } else {                                                                                   \
+        publish();                                                                               \
+      }                                                                                          \
+    };                                                                                           \
+  }                                                                                              \
+                                                                                                 \
+public:                                                                                          \
+  /* While attached to a FrameSnapshot, whether its last capture pinned a new message */         \
+  bool has_new()                                                                                 \
+  {                                                                                              \
+    return is_snapshot_attached() ? snapshot_->is_dirty() : latest_msg_->has_new();              \
+  }                                                                                              \
+  /* Does nothing while attached to a FrameSnapshot, whose capture consumes the messages */      \
+  void set_old()                                                                                 \
+  {                                                                                              \
+    if (is_snapshot_attached()) return;                                                          \
+    consume_latest_message(*latest_msg_, stats_);                                                \
+  }                                                                                              \
+  void set_history_size(const int size) { history_->set_capacity(std::max(size, 0)); }           \
+  int get_history_size() const { return static_cast<int>(history_->get_capacity()); }            \
+  double get_ros_time() const { return GodotRviz2::get_instance().get_node()->now().seconds(); } \
+                                                                                                 \
+  void subscribe(const String & topic, const bool transient_local = false)                       \
+  {                                                                                              \
+    subscribe_with_qos(topic, get_default_qos(transient_local), rclcpp::SubscriptionOptions());  \
+  }                                                                                              \
+                                                                                                 \
+  /* Subscribes with the QoS keys of make_qos applied on top of the defaults of subscribe, */    \
+  /* and the subscription options of make_subscription_options */                                \
+  void subscribe_with_options(const String & topic, const Dictionary & options)                  \
+  {                                                                                              \
+    const bool transient_local = options.get("durability", "") == Variant("transient_local");    \
+    const rclcpp::QoS qos = make_qos(options, get_default_qos(transient_local));                 \
+    subscribe_with_qos(topic, qos, make_subscription_options(options, qos));                     \
+  }                                                                                              \
+                                                                                                 \
+  /* Delivers a message as if it had been received on the subscribed topic, e.g. to replay */    \
+  /* recorded messages. Not bound to Godot. */                                                   \
+  void receive_message(const ConstSharedPtr & msg) { make_message_callback()(msg); }             \
+                                                                                                 \
+  /* Lets the snapshot pin the message the getters convert, see FrameSnapshot */                 \
+  void attach_to_snapshot(const Ref<FrameSnapshot> & snapshot, const String & name)              \
+  {                                                                                              \
+    if (snapshot.is_null()) return;                                                              \
+    if (!snapshot_) snapshot_ = std::make_shared<MessageSnapshot<TYPE>>(latest_msg_);            \
+    snapshot_->set_stats(stats_);                                                                \
+    snapshot->add_source(name, snapshot_);                                                       \
   }
 
-#define TOPIC_SUBSCRIBER_BIND_METHODS(TYPE)                      \
-  ClassDB::bind_method(D_METHOD("subscribe"), &TYPE::subscribe); \
-  ClassDB::bind_method(D_METHOD("has_new"), &TYPE::has_new);     \
-  ClassDB::bind_method(D_METHOD("set_old"), &TYPE::set_old)
+#define TOPIC_SUBSCRIBER_BIND_METHODS(TYPE)                                                 \
+  ClassDB::bind_method(D_METHOD("subscribe"), &TYPE::subscribe);                            \
+  ClassDB::bind_method(                                                                     \
+    D_METHOD("subscribe_with_options", "topic", "options"), &TYPE::subscribe_with_options); \
+  ClassDB::bind_method(D_METHOD("has_new"), &TYPE::has_new);                                \
+  ClassDB::bind_method(D_METHOD("set_old"), &TYPE::set_old);                                \
+  ClassDB::bind_method(D_METHOD("set_history_size", "size"), &TYPE::set_history_size);      \
+  ClassDB::bind_method(D_METHOD("get_history_size"), &TYPE::get_history_size);              \
+  ClassDB::bind_method(D_METHOD("get_ros_time"), &TYPE::get_ros_time);                      \
+  ClassDB::bind_method(                                                                     \
+    D_METHOD("attach_to_snapshot", "snapshot", "name"), &TYPE::attach_to_snapshot);         \
+  ADD_PROPERTY(                                                                             \
+    PropertyInfo(Variant::INT, "history_size"), "set_history_size", "get_history_size")
 
 #else
 #include "core/object/ref_counted.h"
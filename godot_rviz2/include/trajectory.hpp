@@ -19,6 +19,9 @@
 #include "core/object/ref_counted.h"
 #include "core/string/ustring.h"
 #include "core/variant/variant.h"
+#include "mesh_arrays.hpp"
+#include "precompute.hpp"
+#include "strip_cache.hpp"
 #include "topic_subscriber.hpp"
 
 #include "autoware_auto_planning_msgs/msg/trajectory.hpp"
@@ -43,6 +46,16 @@ public:
    */
   Array get_trajectory_triangle_strip(const float width);
 
+  /**
+   * @brief Generates the trajectory triangle strip as Mesh.ARRAY_* channels.
+   *
+   * The velocities are stored in ARRAY_CUSTOM0, see MeshArrays::to_array.
+   *
+   * @param width Width of the trajectory
+   * @return Array to pass to add_surface_from_arrays
+   */
+  Array get_trajectory_triangle_strip_arrays(const float width);
+
   /**
    * @brief Generates a triangle strip for the wall.
    *
@@ -57,7 +70,31 @@ public:
     const float width, const float height, const float length_offset, const bool ignore_start_point,
     const bool ignore_end_point);
 
-  Trajectory() = default;
+  /**
+   * @brief Generates the wall triangle strip as Mesh.ARRAY_* channels.
+   *
+   * Takes the same parameters as get_wall_triangle_strip.
+   *
+   * @return Array to pass to add_surface_from_arrays
+   */
+  Array get_wall_triangle_strip_arrays(
+    const float width, const float height, const float length_offset, const bool ignore_start_point,
+    const bool ignore_end_point);
+
+  /**
+   * @brief Builds the trajectory triangle strip of every received message in the subscription
+   * callback.
+   *
+   * @param width Width get_trajectory_triangle_strip will be called with
+   */
+  void enable_precompute(const float width);
+
+  /**
+   * @brief Stops building the triangle strip in the subscription callback.
+   */
+  void disable_precompute();
+
+  Trajectory();
   ~Trajectory() = default;
 
 protected:
@@ -67,19 +104,28 @@ protected:
   static void _bind_methods();
 
 private:
+  using TriangleStripPrecompute =
+    Precompute<autoware_auto_planning_msgs::msg::Trajectory, float, MeshArrays>;
+  std::shared_ptr<TriangleStripPrecompute> precompute_;
+  // Strip of the messages converted by the getters on the main thread
+  StripCache<rviz_core::PoseStripBuilder> strip_cache_;
+
   /**
-   * @brief Creates a dictionary representing a point in the trajectory.
+   * @brief Gets the trajectory triangle strip of the latest message, precomputed if possible.
    *
-   * This method calculates the rotated offset and normal for a given position and quaternion,
-   * and then converts these to a Godot-friendly format.
+   * @param width Width of the trajectory
+   * @return Triangle strip channels
+   */
+  MeshArrays get_latest_trajectory_triangle_strip(const float width);
+
+  /**
+   * @brief Generates the wall triangle strip of the latest message.
    *
-   * @param quat Quaternion representing the orientation
-   * @param position Position vector
-   * @param width_offset Offset applied to the width
-   * @param velocity Velocity at this point
-   * @return A Dictionary containing position, normal, and velocity
+   * Takes the same parameters as get_wall_triangle_strip.
+   *
+   * @return Triangle strip channels
    */
-  Dictionary create_point_dict(
-    const Eigen::Quaternionf & quat, const Eigen::Vector3f & position, const float width_offset,
-    const float velocity);
+  MeshArrays convert_wall_triangle_strip(
+    const float width, const float height, const float length_offset, const bool ignore_start_point,
+    const bool ignore_end_point);
 };
@@ -17,6 +17,7 @@
 #pragma once
 #include "core/string/ustring.h"
 #include "core/variant/variant.h"
+#include "rviz_core/geometry.hpp"
 #include "rclcpp/rclcpp.hpp"
 #include "tf2_ros/buffer.h"
 #include "tf2_ros/transform_listener.h"
@@ -27,8 +28,10 @@
 #include "geometry_msgs/msg/transform.hpp"
 #include "tf2_geometry_msgs/tf2_geometry_msgs.h"
 
+#include <cstdint>
 #include <optional>
 #include <string>
+#include <vector>
 
 #define EIGEN_MPL2_ONLY
 #include <eigen3/Eigen/Core>
@@ -41,11 +44,24 @@
  * @param source_frame_id The source frame ID for the transformation.
  * @param target_frame_id The target frame ID for the transformation.
  * @param time The specific time at which to retrieve the transformation.
+ * @param timeout How long to wait for the transformation. The default never blocks, which is what
+ * callers on Godot's main thread need.
  * @return std::optional<geometry_msgs::msg::Transform> The transformation, if found.
  */
 std::optional<geometry_msgs::msg::Transform> get_transform(
   const tf2_ros::Buffer & tf_buffer, const std::string & source_frame_id,
-  const std::string & target_frame_id, const rclcpp::Time & time);
+  const std::string & target_frame_id, const rclcpp::Time & time,
+  const rclcpp::Duration & timeout = rclcpp::Duration(0, 0));
+
+/**
+ * @brief Retrieves a transformation and the stamp it was resolved at from the TF2 buffer.
+ *
+ * See get_transform. The stamp is the one of the latest common transformation when time is 0.
+ */
+std::optional<geometry_msgs::msg::TransformStamped> get_transform_stamped(
+  const tf2_ros::Buffer & tf_buffer, const std::string & source_frame_id,
+  const std::string & target_frame_id, const rclcpp::Time & time,
+  const rclcpp::Duration & timeout = rclcpp::Duration(0, 0));
 
 /**
  * @brief Converts a Godot String to a standard string.
@@ -77,73 +93,3 @@ inline Vector3 ros2_to_godot(const geometry_msgs::msg::Vector3 & p)
 {
   return ros2_to_godot(p.x, p.y, p.z);
 }
-
-/**
- * @brief Calculates the cross product of two Eigen::Vector3f vectors.
- *
- * @param a The first vector.
- * @param b The second vector.
- * @return Eigen::Vector3f The cross product.
- */
-Eigen::Vector3f cross_product(const Eigen::Vector3f & a, const Eigen::Vector3f & b);
-
-/**
- * @brief Generates a 3D bounding box.
- *
- * @param width The width of the bounding box.
- * @param height The height of the bounding box.
- * @param length The length of the bounding box.
- * @param translation The translation component of the bounding box's transformation.
- * @param quaternion The rotation component of the bounding box's transformation.
- * @param vertices Output vector of vertices defining the bounding box.
- * @param normals Output vector of normals for each vertex.
- */
-void generate_boundingbox3d(
-  float width, float height, float length, const Eigen::Translation3f & translation,
-  const Eigen::Quaternionf & quaternion, std::vector<Vector3> & vertices,
-  std::vector<Vector3> & normals);
-
-/**
- * @brief Generates a 3D cylinder.
- *
- * @param radius The radius of the cylinder.
- * @param height The height of the cylinder.
- * @param translation The translation component of the cylinder's transformation.
- * @param quaternion The rotation component of the cylinder's transformation.
- * @param vertices Output vector of vertices defining the cylinder.
- * @param normals Output vector of normals for each vertex.
- */
-void generate_cylinder3d(
-  float radius, float height, const Eigen::Translation3f & translation,
-  const Eigen::Quaternionf & quaternion, std::vector<Vector3> & vertices,
-  std::vector<Vector3> & normals);
-
-/**
- * @brief Generates a 3D polygon from a 2D polygon and a height.
- *
- * @param polygon_2d The 2D polygon to extrude.
- * @param height The height of the extrusion.
- * @param translation The translation component of the polygon's transformation.
- * @param quaternion The rotation component of the polygon's transformation.
- * @param vertices Output vector of vertices defining the 3D polygon.
- * @param normals Output vector of normals for each vertex.
- */
-void generate_polygon3d(
-  const geometry_msgs::msg::Polygon & polygon_2d, float height,
-  const Eigen::Translation3f & translation, const Eigen::Quaternionf & quaternion,
-  std::vector<Vector3> & vertices, std::vector<Vector3> & normals);
-
-/**
- * @brief Overload of generate_polygon3d for a vector of Vector2.
- *
- * @param polygon_2d The 2D polygon defined by a vector of Vector2 to extrude.
- * @param height The height of the extrusion.
- * @param translation The translation component of the polygon's transformation.
- * @param quaternion The rotation component of the polygon's transformation.
- * @param vertices Output vector of vertices defining the 3D polygon.
- * @param normals Output vector of normals for each vertex.
- */
-void generate_polygon3d(
-  const std::vector<Vector2> & polygon_2d, float height, const Eigen::Translation3f & translation,
-  const Eigen::Quaternionf & quaternion, std::vector<Vector3> & vertices,
-  std::vector<Vector3> & normals);
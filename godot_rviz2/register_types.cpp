@@ -17,18 +17,29 @@
 #include "register_types.h"
 
 #include "behavior_path.hpp"
+#include "core/config/engine.h"
 #include "core/object/class_db.h"
 #include "dynamic_objects.hpp"
 #include "ego_pose.hpp"
+#include "frame_snapshot.hpp"
+#include "godot_rviz2_stats.hpp"
 #include "marker_array.hpp"
+#include "mesh_builder.hpp"
 #include "parameter.hpp"
 #include "pointcloud.hpp"
+#include "pointcloud_map.hpp"
 #include "spinner.hpp"
 #include "steering_report.hpp"
 #include "trajectory.hpp"
 #include "vehicle_status.hpp"
 #include "velocity_report.hpp"
 
+#ifdef GODOT_RVIZ2_BENCHMARK
+#include "benchmark/conversion_benchmark.hpp"
+#endif
+
+static GodotRviz2Stats * stats_singleton = nullptr;
+
 void initialize_godot_rviz2_module(ModuleInitializationLevel p_level)
 {
   if (p_level != MODULE_INITIALIZATION_LEVEL_SCENE) {
@@ -36,7 +47,9 @@ void initialize_godot_rviz2_module(ModuleInitializationLevel p_level)
   }
   ClassDB::register_class<GodotRviz2Spinner>();
   ClassDB::register_class<MarkerArray>();
+  ClassDB::register_class<MeshBuilder>();
   ClassDB::register_class<PointCloud>();
+  ClassDB::register_class<PointCloudMap>();
   ClassDB::register_class<BehaviorPath>();
   ClassDB::register_class<Trajectory>();
   ClassDB::register_class<DynamicObjects>();
@@ -45,6 +58,13 @@ void initialize_godot_rviz2_module(ModuleInitializationLevel p_level)
   ClassDB::register_class<SteeringReport>();
   ClassDB::register_class<VelocityReport>();
   ClassDB::register_class<Parameter>();
+  ClassDB::register_class<FrameSnapshot>();
+  ClassDB::register_class<GodotRviz2Stats>();
+#ifdef GODOT_RVIZ2_BENCHMARK
+  ClassDB::register_class<GodotRviz2Benchmark>();
+#endif
+  stats_singleton = memnew(GodotRviz2Stats);
+  Engine::get_singleton()->add_singleton(Engine::Singleton("GodotRviz2Stats", stats_singleton));
 }
 
 void uninitialize_godot_rviz2_module(ModuleInitializationLevel p_level)
@@ -52,4 +72,9 @@ void uninitialize_godot_rviz2_module(ModuleInitializationLevel p_level)
   if (p_level != MODULE_INITIALIZATION_LEVEL_SCENE) {
     return;
   }
+  if (stats_singleton) {
+    Engine::get_singleton()->remove_singleton("GodotRviz2Stats");
+    memdelete(stats_singleton);
+    stats_singleton = nullptr;
+  }
 }
@@ -0,0 +1,127 @@
+//
+//  Copyright 2022 Yukihiro Saito. All rights reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#include "disk_cache.hpp"
+
+#include "core/io/dir_access.h"
+#include "core/io/file_access.h"
+#include "core/os/thread.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace
+{
+const char * cache_dir = "user://godot_rviz2_cache";
+// Written before the value so files of an incompatible layout are ignored
+const uint32_t cache_magic = 0x43525247;  // "GRRC"
+const uint32_t cache_version = 3;
+}  // namespace
+
+uint64_t DiskCache::hash_bytes(const void * data, const size_t size, const uint64_t seed)
+{
+  const uint8_t * bytes = static_cast<const uint8_t *>(data);
+  uint64_t hash = seed;
+  for (size_t i = 0; i < size; ++i) {
+    hash ^= bytes[i];
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+String DiskCache::get_dir() const { return String(cache_dir).path_join(name_); }
+
+String DiskCache::get_path(const uint64_t key) const
+{
+  return get_dir().path_join(String::num_uint64(key, 16) + ".bin");
+}
+
+bool DiskCache::load(const uint64_t key, Variant & r_value) const
+{
+  if (!is_enabled()) return false;
+
+  const Ref<FileAccess> file = FileAccess::open(get_path(key), FileAccess::READ);
+  if (file.is_null()) return false;
+  if (file->get_32() != cache_magic || file->get_32() != cache_version) return false;
+  r_value = file->get_var();
+  return file->get_error() == OK;
+}
+
+void DiskCache::store(const uint64_t key, const Variant & value) const
+{
+  if (!is_enabled()) return;
+
+  if (DirAccess::make_dir_recursive_absolute(get_dir()) != OK) return;
+  // Write to a temporary file first so a crash never leaves a truncated cache file behind
+  const String path = get_path(key);
+  const String tmp_path = path + "." + itos(Thread::get_caller_id()) + ".tmp";
+  {
+    const Ref<FileAccess> file = FileAccess::open(tmp_path, FileAccess::WRITE);
+    if (file.is_null()) return;
+    file->store_32(cache_magic);
+    file->store_32(cache_version);
+    file->store_var(value);
+    if (file->get_error() != OK) {
+      file->close();
+      DirAccess::remove_absolute(tmp_path);
+      return;
+    }
+  }
+  DirAccess::remove_absolute(path);
+  if (DirAccess::rename_absolute(tmp_path, path) == OK) evict(path);
+}
+
+void DiskCache::evict(const String & keep_path) const
+{
+  struct Entry
+  {
+    String path;
+    uint64_t modified_time;
+    uint64_t size;
+  };
+
+  // Files of the previous layout, which kept every cache directly in cache_dir
+  for (const String & file_name : DirAccess::get_files_at(cache_dir)) {
+    if (!file_name.ends_with(".bin")) continue;
+    DirAccess::remove_absolute(String(cache_dir).path_join(file_name));
+  }
+
+  const String dir = get_dir();
+  std::vector<Entry> entries;
+  for (const String & file_name : DirAccess::get_files_at(dir)) {
+    if (!file_name.ends_with(".bin")) continue;
+    const String path = dir.path_join(file_name);
+    if (path == keep_path) continue;
+    const Ref<FileAccess> file = FileAccess::open(path, FileAccess::READ);
+    if (file.is_null()) continue;
+    entries.push_back({path, FileAccess::get_modified_time(path), file->get_length()});
+  }
+  // Newest first, so the files past the limits are the ones to remove
+  std::sort(entries.begin(), entries.end(), [](const Entry & a, const Entry & b) {
+    return a.modified_time > b.modified_time;
+  });
+
+  const Ref<FileAccess> kept = FileAccess::open(keep_path, FileAccess::READ);
+  uint64_t total_bytes = kept.is_valid() ? kept->get_length() : 0;
+  int num_entries = 1;
+  for (const Entry & entry : entries) {
+    total_bytes += entry.size;
+    ++num_entries;
+    if (num_entries > max_entries || total_bytes > max_bytes) {
+      DirAccess::remove_absolute(entry.path);
+    }
+  }
+}
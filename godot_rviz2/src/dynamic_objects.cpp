@@ -19,54 +19,460 @@
 #include <tf2_ros/buffer.h>
 #include <tf2_ros/transform_listener.h>
 
+#include <algorithm>
+#include <optional>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
 #define EIGEN_MPL2_ONLY
 #include <eigen3/Eigen/Core>
 #include <eigen3/Eigen/Geometry>
 
 using Label = autoware_auto_perception_msgs::msg::ObjectClassification;
+using PredictedObject = autoware_auto_perception_msgs::msg::PredictedObject;
+using PredictedObjects = autoware_auto_perception_msgs::msg::PredictedObjects;
 
-void DynamicObjects::_bind_methods()
+namespace
 {
-  ClassDB::bind_method(D_METHOD("get_triangle_list"), &DynamicObjects::get_triangle_list);
-  TOPIC_SUBSCRIBER_BIND_METHODS(DynamicObjects);
+/**
+ * @brief Formats an object ID key as 32 lowercase hex digits.
+ */
+String format_uuid_key(const ObjectKey & key)
+{
+  static constexpr char digits[] = "0123456789abcdef";
+  char hex[2 * std::tuple_size<ObjectKey>::value + 1] = {};
+  for (size_t i = 0; i < key.size(); ++i) {
+    hex[2 * i] = digits[key[i] >> 4];
+    hex[2 * i + 1] = digits[key[i] & 0xf];
+  }
+  return String(hex);
 }
 
-Array DynamicObjects::get_triangle_list(bool only_known_objects)
+/**
+ * @brief Gets the class label of an object, UNKNOWN if it has no classification.
+ */
+uint8_t get_label(const autoware_auto_perception_msgs::msg::PredictedObject & object)
 {
-  Array triangle_list;
+  return object.classification.empty() ? Label::UNKNOWN : object.classification.front().label;
+}
 
-  const auto last_msg = get_last_msg();
-  if (!last_msg) return triangle_list;
+/**
+ * @brief Gets the color an object class is drawn with.
+ */
+Color get_label_color(const uint8_t label)
+{
+  switch (label) {
+    case Label::CAR:
+    case Label::TRUCK:
+    case Label::BUS:
+    case Label::TRAILER:
+      return Color(0.2, 0.6, 1.0, 0.8);
+    case Label::MOTORCYCLE:
+    case Label::BICYCLE:
+      return Color(1.0, 0.8, 0.2, 0.8);
+    case Label::PEDESTRIAN:
+      return Color(1.0, 0.4, 0.6, 0.8);
+    default:
+      return Color(0.7, 0.7, 0.7, 0.8);
+  }
+}
+
+/**
+ * @brief Appends an instance to the MultiMesh buffer.
+ *
+ * @param instances The instances to append to.
+ * @param object The object.
+ * @param scale Scale of the unit shape in Godot's coordinate system.
+ */
+void append_instance(
+  ObjectInstances & instances, const autoware_auto_perception_msgs::msg::PredictedObject & object,
+  const Vector3 & scale)
+{
+  const auto & pose = object.kinematics.initial_pose_with_covariance.pose;
+  // Rotating in ROS 2 coordinates and converting equals converting the rotation axis
+  const Quaternion rotation(
+    pose.orientation.x, pose.orientation.z, -pose.orientation.y, pose.orientation.w);
+  const Basis basis(rotation.normalized(), scale);
+  const uint8_t label = get_label(object);
+  instances.append(
+    Transform3D(basis, ros2_to_godot(pose.position)), get_label_color(label),
+    Color(label, 0.0, 0.0, 0.0));
+  instances.labels.push_back(label);
+  instances.ids.push_back(format_uuid_key(get_uuid_key(object.object_id)));
+}
+
+DynamicObjectInstances convert_instances(const PredictedObjects & msg, bool only_known_objects)
+{
+  DynamicObjectInstances instances;
+  rviz_core::MeshBuffers polygons;
+
+  for (const auto & object : msg.objects) {
+    if (only_known_objects && get_label(object) == Label::UNKNOWN) continue;
+    const auto & shape = object.shape;
+    const auto & dimensions = shape.dimensions;
+
+    if (shape.type == autoware_auto_perception_msgs::msg::Shape::BOUNDING_BOX) {
+      append_instance(instances.boxes, object, Vector3(dimensions.x, dimensions.z, dimensions.y));
+    } else if (shape.type == autoware_auto_perception_msgs::msg::Shape::CYLINDER) {
+      append_instance(
+        instances.cylinders, object, Vector3(dimensions.x, dimensions.z, dimensions.x));
+    } else if (shape.type == autoware_auto_perception_msgs::msg::Shape::POLYGON) {
+      const auto & pos = object.kinematics.initial_pose_with_covariance.pose.position;
+      const auto & quat = object.kinematics.initial_pose_with_covariance.pose.orientation;
+      rviz_core::generate_polygon3d_indexed(
+        shape.footprint, dimensions.z, Eigen::Translation3f(pos.x, pos.y, pos.z),
+        Eigen::Quaternionf(quat.w, quat.x, quat.y, quat.z), polygons);
+    }
+  }
+
+  instances.polygons = MeshArrays::from_buffers(polygons);
+  return instances;
+}
+
+/**
+ * @brief Converts the instances of one shape into a Dictionary.
+ */
+Dictionary instances_to_dict(const ObjectInstances & instances)
+{
+  Dictionary dict = instances.to_dict();
+  dict["labels"] = instances.labels;
+  dict["ids"] = instances.ids;
+  return dict;
+}
+
+/**
+ * @brief Converts instances into the Dictionary returned by get_instances.
+ */
+Dictionary instances_to_dict(const DynamicObjectInstances & instances)
+{
+  Dictionary instances_dict;
+  instances_dict["boxes"] = instances_to_dict(instances.boxes);
+  instances_dict["cylinders"] = instances_to_dict(instances.cylinders);
+  instances_dict["polygons"] = instances.polygons.to_array();
+  return instances_dict;
+}
+
+MeshArrays convert_triangle_list(const PredictedObjects & msg, bool only_known_objects)
+{
+  // Collect every object into one indexed buffer
+  rviz_core::MeshBuffers triangle_list;
 
-  for (const auto & object : last_msg.value()->objects) {
-    if (only_known_objects && object.classification.front().label == Label::UNKNOWN) continue;
+  for (const auto & object : msg.objects) {
+    if (only_known_objects && get_label(object) == Label::UNKNOWN) continue;
     const auto & pos = object.kinematics.initial_pose_with_covariance.pose.position;
     const auto & quat = object.kinematics.initial_pose_with_covariance.pose.orientation;
     const auto & shape = object.shape;
 
     Eigen::Translation3f translation(pos.x, pos.y, pos.z);
     Eigen::Quaternionf quaternion(quat.w, quat.x, quat.y, quat.z);
-    std::vector<Vector3> vertices, normals;
 
     if (shape.type == autoware_auto_perception_msgs::msg::Shape::BOUNDING_BOX) {
-      generate_boundingbox3d(
+      rviz_core::generate_boundingbox3d_indexed(
         shape.dimensions.x, shape.dimensions.y, shape.dimensions.z, translation, quaternion,
-        vertices, normals);
+        triangle_list);
     } else if (shape.type == autoware_auto_perception_msgs::msg::Shape::CYLINDER) {
-      generate_cylinder3d(
-        shape.dimensions.x / 2, shape.dimensions.z, translation, quaternion, vertices, normals);
+      rviz_core::generate_cylinder3d_indexed(
+        shape.dimensions.x / 2, shape.dimensions.z, translation, quaternion, triangle_list);
     } else if (shape.type == autoware_auto_perception_msgs::msg::Shape::POLYGON) {
-      generate_polygon3d(
-        shape.footprint, shape.dimensions.z, translation, quaternion, vertices, normals);
+      rviz_core::generate_polygon3d_indexed(
+        shape.footprint, shape.dimensions.z, translation, quaternion, triangle_list);
+    }
+  }
+
+  return MeshArrays::from_buffers(triangle_list);
+}
+
+// Longest time past a message that objects are extrapolated
+constexpr double max_extrapolation = 0.5;
+
+/**
+ * @brief Copies what the instances and meshes are built from, replacing the pose.
+ */
+PredictedObject with_pose(const PredictedObject & object, const geometry_msgs::msg::Pose & pose)
+{
+  PredictedObject moved;
+  moved.object_id = object.object_id;
+  moved.existence_probability = object.existence_probability;
+  moved.classification = object.classification;
+  moved.shape = object.shape;
+  moved.kinematics.initial_pose_with_covariance.pose = pose;
+  moved.kinematics.initial_twist_with_covariance = object.kinematics.initial_twist_with_covariance;
+  return moved;
+}
+
+/**
+ * @brief Moves an object along its twist with constant velocity and yaw rate.
+ */
+geometry_msgs::msg::Pose extrapolate_pose(const PredictedObject & object, const double dt)
+{
+  const auto & pose = object.kinematics.initial_pose_with_covariance.pose;
+  const auto & twist = object.kinematics.initial_twist_with_covariance.twist;
+  tf2::Quaternion rotation;
+  tf2::fromMsg(pose.orientation, rotation);
+  // The twist is given in the object frame
+  const tf2::Vector3 velocity =
+    tf2::quatRotate(rotation, tf2::Vector3(twist.linear.x, twist.linear.y, twist.linear.z));
+  tf2::Quaternion yaw_delta;
+  yaw_delta.setRPY(0.0, 0.0, twist.angular.z * dt);
+
+  geometry_msgs::msg::Pose moved;
+  moved.position.x = pose.position.x + velocity.x() * dt;
+  moved.position.y = pose.position.y + velocity.y() * dt;
+  moved.position.z = pose.position.z + velocity.z() * dt;
+  moved.orientation = tf2::toMsg((rotation * yaw_delta).normalized());
+  return moved;
+}
+
+/**
+ * @brief Interpolates between two poses.
+ */
+geometry_msgs::msg::Pose interpolate_pose(
+  const geometry_msgs::msg::Pose & from, const geometry_msgs::msg::Pose & to, const double ratio)
+{
+  tf2::Quaternion from_rotation, to_rotation;
+  tf2::fromMsg(from.orientation, from_rotation);
+  tf2::fromMsg(to.orientation, to_rotation);
+
+  geometry_msgs::msg::Pose pose;
+  pose.position.x = from.position.x + (to.position.x - from.position.x) * ratio;
+  pose.position.y = from.position.y + (to.position.y - from.position.y) * ratio;
+  pose.position.z = from.position.z + (to.position.z - from.position.z) * ratio;
+  pose.orientation = tf2::toMsg(from_rotation.slerp(to_rotation, ratio).normalized());
+  return pose;
+}
+
+/**
+ * @brief Moves the objects of a message to a render time.
+ *
+ * @param before The message stamped at or before the time.
+ * @param after The message following it, or nullptr.
+ * @param dt Time from the stamp of before to the render time in seconds.
+ * @param span Time from the stamp of before to the stamp of after in seconds.
+ */
+PredictedObjects move_objects(
+  const PredictedObjects & before, const PredictedObjects * after, const double dt,
+  const double span)
+{
+  std::unordered_map<ObjectKey, const PredictedObject *, ObjectKeyHash> after_objects;
+  if (after && span > 0.0) {
+    after_objects.reserve(after->objects.size());
+    for (const auto & object : after->objects) {
+      after_objects.emplace(get_uuid_key(object.object_id), &object);
     }
-    for (size_t i = 0; i < vertices.size(); ++i) {
-      Dictionary point_dict;
-      point_dict["position"] = ros2_to_godot(vertices[i].x, vertices[i].y, vertices[i].z);
-      point_dict["normal"] = ros2_to_godot(normals[i].x, normals[i].y, normals[i].z);
-      triangle_list.append(point_dict);
+  }
+
+  PredictedObjects moved;
+  moved.header = before.header;
+  moved.objects.reserve(before.objects.size());
+  for (const auto & object : before.objects) {
+    const auto it = after_objects.find(get_uuid_key(object.object_id));
+    if (it != after_objects.end()) {
+      moved.objects.push_back(with_pose(
+        object, interpolate_pose(
+                  object.kinematics.initial_pose_with_covariance.pose,
+                  it->second->kinematics.initial_pose_with_covariance.pose, dt / span)));
+    } else {
+      moved.objects.push_back(with_pose(object, extrapolate_pose(object, dt)));
+    }
+  }
+  return moved;
+}
+}  // namespace
+
+DynamicObjects::DynamicObjects()
+: precompute_(std::make_shared<TriangleListPrecompute>(convert_triangle_list)),
+  instances_precompute_(std::make_shared<InstancesPrecompute>(convert_instances)),
+  mesh_builder_(memnew(MeshBuilder))
+{
+  message_hook_ = [precompute = precompute_,
+                   instances_precompute = instances_precompute_](const ConstSharedPtr & msg) {
+    precompute->on_message(msg);
+    instances_precompute->on_message(msg);
+  };
+}
+
+void DynamicObjects::_bind_methods()
+{
+  ClassDB::bind_method(D_METHOD("get_triangle_list"), &DynamicObjects::get_triangle_list);
+  ClassDB::bind_method(
+    D_METHOD("get_triangle_list_arrays", "only_known_objects"),
+    &DynamicObjects::get_triangle_list_arrays, DEFVAL(false));
+  ClassDB::bind_method(
+    D_METHOD("update_mesh", "mesh_instance", "only_known_objects"), &DynamicObjects::update_mesh,
+    DEFVAL(false));
+  ClassDB::bind_method(
+    D_METHOD("enable_precompute", "only_known_objects"), &DynamicObjects::enable_precompute,
+    DEFVAL(false));
+  ClassDB::bind_method(D_METHOD("disable_precompute"), &DynamicObjects::disable_precompute);
+  // Bind the instancing methods to Godot
+  ClassDB::bind_method(
+    D_METHOD("get_instances", "only_known_objects"), &DynamicObjects::get_instances,
+    DEFVAL(false));
+  ClassDB::bind_method(
+    D_METHOD(
+      "update_multimesh", "box_multimesh", "cylinder_multimesh", "polygon_mesh_instance",
+      "only_known_objects"),
+    &DynamicObjects::update_multimesh, DEFVAL(false));
+  ClassDB::bind_method(
+    D_METHOD("get_instances_at", "time", "only_known_objects"), &DynamicObjects::get_instances_at,
+    DEFVAL(false));
+  ClassDB::bind_method(
+    D_METHOD(
+      "update_multimesh_at", "time", "box_multimesh", "cylinder_multimesh",
+      "polygon_mesh_instance", "only_known_objects"),
+    &DynamicObjects::update_multimesh_at, DEFVAL(false));
+  ClassDB::bind_method(
+    D_METHOD("enable_instances_precompute", "only_known_objects"),
+    &DynamicObjects::enable_instances_precompute, DEFVAL(false));
+  ClassDB::bind_method(
+    D_METHOD("disable_instances_precompute"), &DynamicObjects::disable_instances_precompute);
+  ClassDB::bind_method(D_METHOD("get_removed_objects"), &DynamicObjects::get_removed_objects);
+  TOPIC_SUBSCRIBER_BIND_METHODS(DynamicObjects);
+}
+
+void DynamicObjects::enable_precompute(bool only_known_objects)
+{
+  precompute_->enable(only_known_objects);
+}
+
+void DynamicObjects::disable_precompute() { precompute_->disable(); }
+
+void DynamicObjects::enable_instances_precompute(bool only_known_objects)
+{
+  instances_precompute_->enable(only_known_objects);
+}
+
+void DynamicObjects::disable_instances_precompute() { instances_precompute_->disable(); }
+
+MeshArrays DynamicObjects::get_latest_triangle_list(bool only_known_objects)
+{
+  const auto last_msg = get_last_msg();
+  if (!last_msg) return MeshArrays();
+
+  const auto precomputed = precompute_->get(last_msg.value());
+  if (precomputed && precomputed->param == only_known_objects) return precomputed->result;
+
+  return convert_triangle_list(*last_msg.value(), only_known_objects);
+}
+
+Array DynamicObjects::get_triangle_list(bool only_known_objects)
+{
+  const auto timer = measure_conversion("get_triangle_list");
+  return get_latest_triangle_list(only_known_objects).to_point_dicts();
+}
+
+Array DynamicObjects::get_triangle_list_arrays(bool only_known_objects)
+{
+  const auto timer = measure_conversion("get_triangle_list_arrays");
+  return get_latest_triangle_list(only_known_objects).to_array();
+}
+
+void DynamicObjects::update_mesh(MeshInstance3D * mesh_instance, bool only_known_objects)
+{
+  const auto timer = measure_conversion("update_mesh");
+  mesh_builder_->attach(mesh_instance);
+  // Index buffers cannot be updated in place, so the persistent surface is non-indexed
+  mesh_builder_->update_surface(
+    0, Mesh::PRIMITIVE_TRIANGLES,
+    get_latest_triangle_list(only_known_objects).expand_indices().to_array());
+}
+
+DynamicObjectInstances DynamicObjects::get_latest_instances(bool only_known_objects)
+{
+  const auto last_msg = get_last_msg();
+  if (!last_msg) return DynamicObjectInstances();
+
+  const auto precomputed = instances_precompute_->get(last_msg.value());
+  if (precomputed && precomputed->param == only_known_objects) return precomputed->result;
+
+  return convert_instances(*last_msg.value(), only_known_objects);
+}
+
+Dictionary DynamicObjects::get_instances(bool only_known_objects)
+{
+  const auto timer = measure_conversion("get_instances");
+  return instances_to_dict(get_latest_instances(only_known_objects));
+}
+
+void DynamicObjects::update_multimesh(
+  const Ref<MultiMesh> & box_multimesh, const Ref<MultiMesh> & cylinder_multimesh,
+  MeshInstance3D * polygon_mesh_instance, bool only_known_objects)
+{
+  const auto timer = measure_conversion("update_multimesh");
+  write_instances(
+    get_latest_instances(only_known_objects), box_multimesh, cylinder_multimesh,
+    polygon_mesh_instance);
+}
+
+DynamicObjectInstances DynamicObjects::get_instances_at_time(
+  const double time, bool only_known_objects)
+{
+  const int64_t stamp = static_cast<int64_t>(time * 1e9);
+  std::optional<MessageHistory<PredictedObjects>::Sample> before, after;
+  if (const auto bracket = history_->get_bracket(stamp)) {
+    before = bracket->first;
+    after = bracket->second;
+  } else if (const auto last_msg = get_last_msg()) {
+    const int64_t last_stamp = rclcpp::Time(last_msg.value()->header.stamp).nanoseconds();
+    before = MessageHistory<PredictedObjects>::Sample{last_stamp, last_msg.value()};
+  }
+  if (!before) return DynamicObjectInstances();
+
+  const double dt = (stamp - before->stamp) * 1e-9;
+  // Before every message, or too long after the last one to extrapolate
+  if (dt <= 0.0 || (!after && dt > max_extrapolation)) {
+    return convert_instances(*before->msg, only_known_objects);
+  }
+  const double span = after ? (after->stamp - before->stamp) * 1e-9 : 0.0;
+  const auto moved = move_objects(*before->msg, after ? after->msg.get() : nullptr, dt, span);
+  return convert_instances(moved, only_known_objects);
+}
+
+Dictionary DynamicObjects::get_instances_at(const double time, bool only_known_objects)
+{
+  const auto timer = measure_conversion("get_instances_at");
+  return instances_to_dict(get_instances_at_time(time, only_known_objects));
+}
+
+void DynamicObjects::update_multimesh_at(
+  const double time, const Ref<MultiMesh> & box_multimesh,
+  const Ref<MultiMesh> & cylinder_multimesh, MeshInstance3D * polygon_mesh_instance,
+  bool only_known_objects)
+{
+  const auto timer = measure_conversion("update_multimesh_at");
+  write_instances(
+    get_instances_at_time(time, only_known_objects), box_multimesh, cylinder_multimesh,
+    polygon_mesh_instance);
+}
+
+PackedStringArray DynamicObjects::get_removed_objects()
+{
+  std::unordered_set<ObjectKey, ObjectKeyHash> objects;
+  if (const auto last_msg = get_last_msg()) {
+    objects.reserve(last_msg.value()->objects.size());
+    for (const auto & object : last_msg.value()->objects) {
+      objects.insert(get_uuid_key(object.object_id));
     }
   }
 
-  return triangle_list;
+  PackedStringArray removed;
+  for (const auto & key : tracked_objects_) {
+    if (objects.count(key) == 0) removed.push_back(format_uuid_key(key));
+  }
+  tracked_objects_ = std::move(objects);
+  return removed;
+}
+
+void DynamicObjects::write_instances(
+  const DynamicObjectInstances & instances, const Ref<MultiMesh> & box_multimesh,
+  const Ref<MultiMesh> & cylinder_multimesh, MeshInstance3D * polygon_mesh_instance)
+{
+  instances.boxes.write_to(box_multimesh);
+  instances.cylinders.write_to(cylinder_multimesh);
+  if (polygon_mesh_instance == nullptr) return;
+  mesh_builder_->attach(polygon_mesh_instance);
+  mesh_builder_->update_surface(
+    0, Mesh::PRIMITIVE_TRIANGLES, instances.polygons.expand_indices().to_array());
 }
@@ -15,6 +15,61 @@
 //
 
 #include "ego_pose.hpp"
+
+namespace
+{
+// Longest time past the latest transformation that is extrapolated
+constexpr double max_extrapolation = 0.5;
+// Time span the velocity for extrapolation is taken over
+constexpr double extrapolation_span = 0.1;
+
+/**
+ * @brief Interpolates between two transformations, or extrapolates for a ratio above 1.
+ */
+geometry_msgs::msg::Transform blend_transforms(
+  const geometry_msgs::msg::Transform & from, const geometry_msgs::msg::Transform & to,
+  const double ratio)
+{
+  const auto & p0 = from.translation;
+  const auto & p1 = to.translation;
+  const tf2::Quaternion q0(from.rotation.x, from.rotation.y, from.rotation.z, from.rotation.w);
+  const tf2::Quaternion q1(to.rotation.x, to.rotation.y, to.rotation.z, to.rotation.w);
+  const tf2::Quaternion q = q0.slerp(q1, ratio).normalized();
+
+  geometry_msgs::msg::Transform blended;
+  blended.translation.x = p0.x + (p1.x - p0.x) * ratio;
+  blended.translation.y = p0.y + (p1.y - p0.y) * ratio;
+  blended.translation.z = p0.z + (p1.z - p0.z) * ratio;
+  blended.rotation.x = q.x();
+  blended.rotation.y = q.y();
+  blended.rotation.z = q.z();
+  blended.rotation.w = q.w();
+  return blended;
+}
+}  // namespace
+
+Dictionary EgoPose::get_ego_pose_at(const double time)
+{
+  const auto tf_cache = GodotRviz2::get_instance().get_tf_cache();
+  const rclcpp::Time stamp(static_cast<int64_t>(time * 1e9), RCL_ROS_TIME);
+  if (const auto transform = tf_cache->lookup("base_link", "map", stamp)) {
+    return to_pose_dict(transform);
+  }
+
+  // Past the latest transformation, or before the TF2 buffer starts
+  const auto latest = tf_cache->lookup_stamped("base_link", "map", rclcpp::Time(0));
+  if (!latest) return to_pose_dict(std::nullopt);
+  const rclcpp::Time latest_stamp(latest->header.stamp, RCL_ROS_TIME);
+  const double ahead = (stamp - latest_stamp).seconds();
+  if (ahead <= 0.0 || ahead > max_extrapolation) return to_pose_dict(latest->transform);
+
+  const auto previous = tf_cache->lookup_stamped(
+    "base_link", "map", latest_stamp - rclcpp::Duration::from_seconds(extrapolation_span));
+  if (!previous) return to_pose_dict(latest->transform);
+  const double span = (latest_stamp - rclcpp::Time(previous->header.stamp, RCL_ROS_TIME)).seconds();
+  if (span <= 0.0) return to_pose_dict(latest->transform);
+  return to_pose_dict(blend_transforms(previous->transform, latest->transform, 1.0 + ahead / span));
+}
 /**
  * @brief Binds methods of the EgoPose class to the Godot system.
  */
@@ -24,4 +79,9 @@ void EgoPose::_bind_methods()
   ClassDB::bind_method(D_METHOD("get_ego_position"), &EgoPose::get_ego_position);
   // Bind the get_ego_rotation method to Godot
   ClassDB::bind_method(D_METHOD("get_ego_rotation"), &EgoPose::get_ego_rotation);
+  // Bind the get_ego_pose method to Godot
+  ClassDB::bind_method(D_METHOD("get_ego_pose"), &EgoPose::get_ego_pose);
+  // Bind the interpolated pose methods to Godot
+  ClassDB::bind_method(D_METHOD("get_ego_pose_at", "time"), &EgoPose::get_ego_pose_at);
+  ClassDB::bind_method(D_METHOD("get_ros_time"), &EgoPose::get_ros_time);
 }
@@ -0,0 +1,106 @@
+//
+//  Copyright 2022 Yukihiro Saito. All rights reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#include "frame_snapshot.hpp"
+
+#include <algorithm>
+
+void FrameSnapshot::_bind_methods()
+{
+  ClassDB::bind_method(D_METHOD("capture"), &FrameSnapshot::capture);
+  ClassDB::bind_method(D_METHOD("release"), &FrameSnapshot::release);
+  ClassDB::bind_method(D_METHOD("is_dirty", "name"), &FrameSnapshot::is_dirty);
+  ClassDB::bind_method(D_METHOD("get_dirty"), &FrameSnapshot::get_dirty);
+  ClassDB::bind_method(D_METHOD("get_names"), &FrameSnapshot::get_names);
+  ClassDB::bind_method(D_METHOD("get_frame"), &FrameSnapshot::get_frame);
+  ClassDB::bind_method(D_METHOD("remove", "name"), &FrameSnapshot::remove);
+}
+
+FrameSnapshot::~FrameSnapshot()
+{
+  for (const auto & entry : entries_) {
+    if (const auto source = entry.source.lock()) source->set_attached(false);
+  }
+}
+
+PackedStringArray FrameSnapshot::capture()
+{
+  // Drop the subscribers that were freed
+  entries_.erase(
+    std::remove_if(
+      entries_.begin(), entries_.end(), [](const Entry & entry) { return entry.source.expired(); }),
+    entries_.end());
+
+  // Pin every message first and build the Variant result afterwards, so the captures of all
+  // subscribers are as close together as possible
+  std::vector<const Entry *> dirty;
+  dirty.reserve(entries_.size());
+  for (const auto & entry : entries_) {
+    if (entry.source.lock()->capture()) dirty.push_back(&entry);
+  }
+
+  dirty_.resize(dirty.size());
+  String * names = dirty_.ptrw();
+  for (size_t i = 0; i < dirty.size(); ++i) {
+    names[i] = dirty[i]->name;
+  }
+  ++frame_;
+  return dirty_;
+}
+
+void FrameSnapshot::release()
+{
+  for (const auto & entry : entries_) {
+    if (const auto source = entry.source.lock()) source->release();
+  }
+  dirty_.clear();
+}
+
+bool FrameSnapshot::is_dirty(const String & name) const
+{
+  for (const auto & entry : entries_) {
+    if (entry.name != name) continue;
+    const auto source = entry.source.lock();
+    return source && source->is_dirty();
+  }
+  return false;
+}
+
+PackedStringArray FrameSnapshot::get_names() const
+{
+  PackedStringArray names;
+  for (const auto & entry : entries_) {
+    if (!entry.source.expired()) names.push_back(entry.name);
+  }
+  return names;
+}
+
+void FrameSnapshot::add_source(const String & name, const std::shared_ptr<SnapshotSource> & source)
+{
+  if (!source) return;
+  remove(name);
+  source->set_attached(true);
+  entries_.push_back(Entry{name, source});
+}
+
+void FrameSnapshot::remove(const String & name)
+{
+  const auto it = std::find_if(
+    entries_.begin(), entries_.end(), [&](const Entry & entry) { return entry.name == name; });
+  if (it == entries_.end()) return;
+  if (const auto source = it->source.lock()) source->set_attached(false);
+  entries_.erase(it);
+}
@@ -15,3 +15,30 @@
 //
 
 #include "godot_rviz2.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+bool GodotRviz2::start_executor(const int num_threads)
+{
+  if (executor_) return false;
+
+  executor_ = std::make_shared<rclcpp::executors::MultiThreadedExecutor>(
+    rclcpp::ExecutorOptions(), static_cast<size_t>(std::max(num_threads, 0)));
+  executor_->add_node(node_);
+  executor_future_ =
+    std::async(std::launch::async, [executor = executor_]() { executor->spin(); });
+  return true;
+}
+
+void GodotRviz2::stop_executor()
+{
+  if (!executor_) return;
+
+  // cancel() is a no-op if spin() has not started yet, so repeat it until the thread exits
+  do {
+    executor_->cancel();
+  } while (executor_future_.wait_for(std::chrono::milliseconds(10)) != std::future_status::ready);
+  executor_->remove_node(node_);
+  executor_.reset();
+}
@@ -0,0 +1,171 @@
+//
+//  Copyright 2022 Yukihiro Saito. All rights reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#include "godot_rviz2_stats.hpp"
+
+#include "godot_rviz2.hpp"
+#include "util.hpp"
+
+#include <chrono>
+#include <string>
+
+GodotRviz2Stats * GodotRviz2Stats::singleton_ = nullptr;
+
+namespace
+{
+Dictionary to_dict(const TopicStats::Percentiles & percentiles)
+{
+  Dictionary dict;
+  dict["count"] = static_cast<int64_t>(percentiles.count);
+  dict["mean"] = percentiles.mean;
+  dict["p50"] = percentiles.p50;
+  dict["p99"] = percentiles.p99;
+  dict["max"] = percentiles.max;
+  return dict;
+}
+
+Dictionary to_dict(const TopicStats::Snapshot & snapshot)
+{
+  Dictionary dict;
+  dict["received"] = static_cast<int64_t>(snapshot.received);
+  dict["dropped"] = static_cast<int64_t>(snapshot.dropped);
+  dict["overwritten"] = static_cast<int64_t>(snapshot.overwritten);
+  dict["consumed"] = static_cast<int64_t>(snapshot.consumed);
+  dict["rate"] = snapshot.rate;
+  dict["delivery_latency"] = to_dict(snapshot.delivery_latency);
+  dict["render_latency"] = to_dict(snapshot.render_latency);
+  Dictionary conversions;
+  for (const auto & [name, percentiles] : snapshot.conversions) {
+    conversions[String(name.c_str())] = to_dict(percentiles);
+  }
+  dict["conversions"] = conversions;
+  return dict;
+}
+
+diagnostic_msgs::msg::KeyValue make_key_value(const std::string & key, const double value)
+{
+  diagnostic_msgs::msg::KeyValue key_value;
+  key_value.key = key;
+  key_value.value = std::to_string(value);
+  return key_value;
+}
+
+void append_percentiles(
+  const std::string & prefix, const TopicStats::Percentiles & percentiles,
+  diagnostic_msgs::msg::DiagnosticStatus & status)
+{
+  status.values.push_back(make_key_value(prefix + " p50", percentiles.p50));
+  status.values.push_back(make_key_value(prefix + " p99", percentiles.p99));
+  status.values.push_back(make_key_value(prefix + " max", percentiles.max));
+}
+
+diagnostic_msgs::msg::DiagnosticStatus to_diagnostic_status(
+  const TopicStats::Snapshot & snapshot, const std::string & hardware_id)
+{
+  diagnostic_msgs::msg::DiagnosticStatus status;
+  status.level = diagnostic_msgs::msg::DiagnosticStatus::OK;
+  status.name = "godot_rviz2: " + snapshot.topic;
+  status.hardware_id = hardware_id;
+  status.message = std::to_string(snapshot.rate) + " Hz";
+  status.values.push_back(make_key_value("received", snapshot.received));
+  status.values.push_back(make_key_value("dropped", snapshot.dropped));
+  status.values.push_back(make_key_value("overwritten", snapshot.overwritten));
+  status.values.push_back(make_key_value("rate", snapshot.rate));
+  append_percentiles("delivery latency", snapshot.delivery_latency, status);
+  append_percentiles("render latency", snapshot.render_latency, status);
+  for (const auto & [name, percentiles] : snapshot.conversions) {
+    append_percentiles(name, percentiles, status);
+  }
+  return status;
+}
+}  // namespace
+
+GodotRviz2Stats::GodotRviz2Stats() { singleton_ = this; }
+
+GodotRviz2Stats::~GodotRviz2Stats()
+{
+  stop_diagnostics();
+  if (singleton_ == this) singleton_ = nullptr;
+}
+
+void GodotRviz2Stats::_bind_methods()
+{
+  ClassDB::bind_method(D_METHOD("get_topics"), &GodotRviz2Stats::get_topics);
+  ClassDB::bind_method(D_METHOD("get_topic_stats", "topic"), &GodotRviz2Stats::get_topic_stats);
+  ClassDB::bind_method(D_METHOD("get_all_stats"), &GodotRviz2Stats::get_all_stats);
+  ClassDB::bind_method(D_METHOD("reset"), &GodotRviz2Stats::reset);
+  ClassDB::bind_method(
+    D_METHOD("start_diagnostics", "topic", "period"), &GodotRviz2Stats::start_diagnostics,
+    DEFVAL("/diagnostics"), DEFVAL(1.0));
+  ClassDB::bind_method(D_METHOD("stop_diagnostics"), &GodotRviz2Stats::stop_diagnostics);
+}
+
+PackedStringArray GodotRviz2Stats::get_topics() const
+{
+  PackedStringArray topics;
+  for (const auto & snapshot : GodotRviz2::get_instance().get_topic_stats()->get_snapshots()) {
+    topics.push_back(String(snapshot.topic.c_str()));
+  }
+  return topics;
+}
+
+Dictionary GodotRviz2Stats::get_topic_stats(const String & topic) const
+{
+  const std::string topic_name = to_std(topic);
+  for (const auto & snapshot : GodotRviz2::get_instance().get_topic_stats()->get_snapshots()) {
+    if (snapshot.topic == topic_name) return to_dict(snapshot);
+  }
+  return Dictionary();
+}
+
+Dictionary GodotRviz2Stats::get_all_stats() const
+{
+  Dictionary stats;
+  for (const auto & snapshot : GodotRviz2::get_instance().get_topic_stats()->get_snapshots()) {
+    stats[String(snapshot.topic.c_str())] = to_dict(snapshot);
+  }
+  return stats;
+}
+
+void GodotRviz2Stats::reset() { GodotRviz2::get_instance().get_topic_stats()->reset(); }
+
+void GodotRviz2Stats::start_diagnostics(const String & topic, const double period)
+{
+  if (period <= 0.0) return;
+
+  const auto node = GodotRviz2::get_instance().get_node();
+  diagnostics_publisher_ =
+    node->create_publisher<diagnostic_msgs::msg::DiagnosticArray>(to_std(topic), 1);
+  diagnostics_timer_ = node->create_wall_timer(
+    std::chrono::duration<double>(period),
+    [publisher = diagnostics_publisher_, node_weak = std::weak_ptr<rclcpp::Node>(node)]() {
+      const auto timer_node = node_weak.lock();
+      if (!timer_node) return;
+      diagnostic_msgs::msg::DiagnosticArray array;
+      array.header.stamp = timer_node->now();
+      for (const auto & snapshot : GodotRviz2::get_instance().get_topic_stats()->get_snapshots()) {
+        array.status.push_back(to_diagnostic_status(snapshot, timer_node->get_name()));
+      }
+      publisher->publish(array);
+    });
+}
+
+void GodotRviz2Stats::stop_diagnostics()
+{
+  if (diagnostics_timer_) diagnostics_timer_->cancel();
+  diagnostics_timer_.reset();
+  diagnostics_publisher_.reset();
+}
@@ -0,0 +1,78 @@
+//
+//  Copyright 2022 Yukihiro Saito. All rights reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#include "instance_buffer.hpp"
+
+#include <algorithm>
+
+void InstanceBuffer::append(
+  const Transform3D & transform, const Color & color, const Color & custom_data)
+{
+  const int offset = count * stride;
+  buffer.resize(offset + stride);
+  float * data = buffer.ptrw() + offset;
+  for (int row = 0; row < 3; ++row) {
+    data[row * 4 + 0] = transform.basis.rows[row].x;
+    data[row * 4 + 1] = transform.basis.rows[row].y;
+    data[row * 4 + 2] = transform.basis.rows[row].z;
+    data[row * 4 + 3] = transform.origin[row];
+  }
+  data[12] = color.r;
+  data[13] = color.g;
+  data[14] = color.b;
+  data[15] = color.a;
+  data[16] = custom_data.r;
+  data[17] = custom_data.g;
+  data[18] = custom_data.b;
+  data[19] = custom_data.a;
+  ++count;
+}
+
+Dictionary InstanceBuffer::to_dict() const
+{
+  Dictionary dict;
+  dict["buffer"] = buffer;
+  dict["count"] = count;
+  return dict;
+}
+
+void InstanceBuffer::write_to(const Ref<MultiMesh> & multimesh) const
+{
+  if (multimesh.is_null()) return;
+
+  // The format can only be changed while the MultiMesh is empty
+  if (
+    multimesh->get_transform_format() != MultiMesh::TRANSFORM_3D ||
+    !multimesh->is_using_colors() || !multimesh->is_using_custom_data()) {
+    multimesh->set_instance_count(0);
+    multimesh->set_transform_format(MultiMesh::TRANSFORM_3D);
+    multimesh->set_use_colors(true);
+    multimesh->set_use_custom_data(true);
+  }
+  if (count > multimesh->get_instance_count()) {
+    multimesh->set_instance_count(next_power_of_2(count));
+  }
+
+  // The buffer has to cover every instance, the hidden ones are zero-scaled
+  const int capacity = multimesh->get_instance_count();
+  if (capacity == 0) return;
+  PackedFloat32Array padded = buffer;
+  padded.resize(capacity * stride);
+  float * data = padded.ptrw();
+  std::fill(data + count * stride, data + capacity * stride, 0.0f);
+  multimesh->set_buffer(padded);
+  multimesh->set_visible_instance_count(count);
+}
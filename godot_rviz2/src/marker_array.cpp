@@ -16,7 +16,11 @@
 
 #include "marker_array.hpp"
 
+#include "core/object/worker_thread_pool.h"
+
+#include <algorithm>
 #include <string>
+#include <vector>
 
 using Type = visualization_msgs::msg::Marker;
 
@@ -29,113 +33,490 @@ bool has_origin_pose(const Type & marker)
          marker.pose.orientation.y != 0 || marker.pose.orientation.z != 0 ||
          marker.pose.orientation.w != 0;
 }
+
+/**
+ * @brief Gets the pose of a marker in Godot's coordinate system.
+ */
+Transform3D get_godot_pose(const Type & marker)
+{
+  const auto & quat = marker.pose.orientation;
+  // Rotating in ROS 2 coordinates and converting equals converting the rotation axis
+  Quaternion rotation(quat.x, quat.z, -quat.y, quat.w);
+  // Markers often leave the orientation all zero
+  rotation = rotation.length_squared() == 0 ? Quaternion() : rotation.normalized();
+  return Transform3D(Basis(rotation), ros2_to_godot(marker.pose.position));
+}
+
+/**
+ * @brief Gets the color of the i-th point of a *_LIST or LINE_STRIP marker.
+ */
+Color get_point_color(const Type & marker, const size_t i)
+{
+  // Per-point colors are only used if there is one for every point, as in RViz
+  const auto & color =
+    marker.colors.size() == marker.points.size() ? marker.colors[i] : marker.color;
+  return Color(color.r, color.g, color.b, color.a);
+}
+
+/**
+ * @brief Converts the markers of one shape into instances of a unit shape.
+ *
+ * Every SPHERE/CUBE marker and every point of a SPHERE_LIST/CUBE_LIST marker becomes one instance,
+ * scaled by the marker scale. The custom data holds the marker ID in its first component.
+ *
+ * @param msg The markers of the namespace, as returned by MarkerStore::get_namespace.
+ * @param shape_type SPHERE or CUBE.
+ * @param list_type SPHERE_LIST or CUBE_LIST.
+ */
+InstanceBuffer convert_instances(
+  const visualization_msgs::msg::MarkerArray & msg, const int32_t shape_type,
+  const int32_t list_type)
+{
+  InstanceBuffer instances;
+  for (const auto & marker : msg.markers) {
+    if (marker.type != shape_type && marker.type != list_type) continue;
+    const Transform3D pose = get_godot_pose(marker);
+    const Basis basis =
+      pose.basis.scaled_local(Vector3(marker.scale.x, marker.scale.z, marker.scale.y));
+    const Color custom_data(marker.id, 0.0, 0.0, 0.0);
+
+    if (marker.type == shape_type) {
+      const Color color(marker.color.r, marker.color.g, marker.color.b, marker.color.a);
+      instances.append(Transform3D(basis, pose.origin), color, custom_data);
+      continue;
+    }
+    for (size_t i = 0; i < marker.points.size(); ++i) {
+      const Vector3 origin = pose.xform(ros2_to_godot(marker.points[i]));
+      instances.append(Transform3D(basis, origin), get_point_color(marker, i), custom_data);
+    }
+  }
+  return instances;
+}
+
+/**
+ * @brief Converts the LINE_LIST and LINE_STRIP markers of one namespace into line segments.
+ *
+ * @param msg The markers of the namespace, as returned by MarkerStore::get_namespace.
+ * @return MeshArrays Vertices and colors for PRIMITIVE_LINES, two vertices per segment.
+ */
+MeshArrays convert_line_list(const visualization_msgs::msg::MarkerArray & msg)
+{
+  int num_vertices = 0;
+  for (const auto & marker : msg.markers) {
+    const int num_points = marker.points.size();
+    if (marker.type == Type::LINE_LIST) num_vertices += num_points / 2 * 2;
+    if (marker.type == Type::LINE_STRIP) num_vertices += std::max(num_points - 1, 0) * 2;
+  }
+
+  MeshArrays line_list;
+  if (num_vertices == 0) return line_list;
+  line_list.vertices.resize(num_vertices);
+  line_list.colors.resize(num_vertices);
+  Vector3 * vertices = line_list.vertices.ptrw();
+  Color * colors = line_list.colors.ptrw();
+
+  int v = 0;
+  const auto append_point = [&](const Type & marker, const Transform3D & pose, const size_t i) {
+    vertices[v] = pose.xform(ros2_to_godot(marker.points[i]));
+    colors[v] = get_point_color(marker, i);
+    ++v;
+  };
+  for (const auto & marker : msg.markers) {
+    const size_t num_points = marker.points.size();
+    if (marker.type == Type::LINE_LIST) {
+      const Transform3D pose = get_godot_pose(marker);
+      for (size_t i = 1; i < num_points; i += 2) {
+        append_point(marker, pose, i - 1);
+        append_point(marker, pose, i);
+      }
+    } else if (marker.type == Type::LINE_STRIP) {
+      const Transform3D pose = get_godot_pose(marker);
+      for (size_t i = 1; i < num_points; ++i) {
+        append_point(marker, pose, i - 1);
+        append_point(marker, pose, i);
+      }
+    }
+  }
+  return line_list;
+}
+
+/**
+ * @brief Triangulation of TRIANGLE_LIST markers split into chunks of markers for WorkerThreadPool.
+ */
+struct TriangleListJob
+{
+  const std::vector<Type> * markers;
+  // Exclusive prefix sum of the vertices written by each marker
+  const std::vector<size_t> * offsets;
+  size_t chunk_size;
+  Vector3 * vertices;
+  Vector3 * normals;
+
+  /**
+   * @brief Triangulates the markers in [begin, end).
+   */
+  void run(const size_t begin, const size_t end) const
+  {
+    for (size_t i = begin; i < end; ++i) {
+      convert_marker((*markers)[i], (*offsets)[i], (*offsets)[i + 1]);
+    }
+  }
+
+  /**
+   * @brief Writes the vertices of one marker to [offset, end_offset).
+   */
+  void convert_marker(const Type & marker, const size_t offset, const size_t end_offset) const
+  {
+    // Unit pose if the marker has none, so one path handles both cases
+    Eigen::Matrix4f transform = Eigen::Matrix4f::Identity();
+    if (has_origin_pose(marker)) {
+      const auto & pos = marker.pose.position;
+      const auto & quat = marker.pose.orientation;
+      const Eigen::Translation3f translation(pos.x, pos.y, pos.z);
+      const Eigen::Quaternionf quaternion(quat.w, quat.x, quat.y, quat.z);
+      transform = (translation * quaternion).matrix();
+    }
+
+    const auto & points = marker.points;
+    for (size_t v = offset, i = 0; v < end_offset; v += 3, i += 3) {
+      const std::array<Eigen::Vector3f, 3> vertices_ros = {
+        (transform * Eigen::Vector4f{points[i].x, points[i].y, points[i].z, 1}).head<3>(),
+        (transform * Eigen::Vector4f{points[i + 1].x, points[i + 1].y, points[i + 1].z, 1})
+          .head<3>(),
+        (transform * Eigen::Vector4f{points[i + 2].x, points[i + 2].y, points[i + 2].z, 1})
+          .head<3>()};
+
+      const auto normal = rviz_core::cross_product(
+                            vertices_ros[2] - vertices_ros[0], vertices_ros[1] - vertices_ros[0])
+                            .normalized();
+
+      const Vector3 godot_normal = ros2_to_godot(normal[0], normal[1], normal[2]);
+      for (size_t k = 0; k < 3; ++k) {
+        vertices[v + k] = ros2_to_godot(vertices_ros[k][0], vertices_ros[k][1], vertices_ros[k][2]);
+        normals[v + k] = godot_normal;
+      }
+    }
+  }
+
+  /**
+   * @brief WorkerThreadPool entry point triangulating one chunk.
+   */
+  static void run_chunk(void * userdata, uint32_t chunk_index)
+  {
+    const auto * job = static_cast<const TriangleListJob *>(userdata);
+    const size_t begin = static_cast<size_t>(chunk_index) * job->chunk_size;
+    job->run(begin, std::min(begin + job->chunk_size, job->markers->size()));
+  }
+};
+
+/**
+ * @brief Triangulates the TRIANGLE_LIST markers of one namespace.
+ *
+ * The output size of every marker is known up front, so the vertices are written into one
+ * preallocated buffer. Markers are split into chunks that write disjoint ranges of it, in parallel
+ * if there is more than one chunk.
+ *
+ * @param msg The markers of the namespace, as returned by MarkerStore::get_namespace.
+ * @param chunk_size Number of markers per WorkerThreadPool task, 0 to triangulate serially.
+ */
+MeshArrays convert_triangle_list(
+  const visualization_msgs::msg::MarkerArray & msg, const int chunk_size)
+{
+  const auto & markers = msg.markers;
+  std::vector<size_t> offsets(markers.size() + 1, 0);
+  for (size_t i = 0; i < markers.size(); ++i) {
+    const size_t num_vertices =
+      markers[i].type == Type::TRIANGLE_LIST ? markers[i].points.size() / 3 * 3 : 0;
+    offsets[i + 1] = offsets[i] + num_vertices;
+  }
+
+  MeshArrays triangle_list;
+  if (offsets.back() == 0) return triangle_list;
+  triangle_list.vertices.resize(offsets.back());
+  triangle_list.normals.resize(offsets.back());
+
+  TriangleListJob job{
+    &markers, &offsets, static_cast<size_t>(std::max(chunk_size, 0)),
+    triangle_list.vertices.ptrw(), triangle_list.normals.ptrw()};
+  if (job.chunk_size == 0 || markers.size() <= job.chunk_size) {
+    job.run(0, markers.size());
+    return triangle_list;
+  }
+
+  const size_t num_chunks = (markers.size() + job.chunk_size - 1) / job.chunk_size;
+  WorkerThreadPool * pool = WorkerThreadPool::get_singleton();
+  const WorkerThreadPool::GroupID group_id = pool->add_native_group_task(
+    &TriangleListJob::run_chunk, &job, static_cast<int>(num_chunks), -1, true,
+    "MarkerArray triangulation");
+  pool->wait_for_group_task_completion(group_id);
+  return triangle_list;
+}
+
+/**
+ * @brief Builds the triangle list of a namespace, going through the disk cache when enabled.
+ */
+Array convert_triangle_list_cached(
+  const DiskCache & disk_cache, const visualization_msgs::msg::MarkerArray & msg,
+  const std::string & ns, const int chunk_size)
+{
+  if (!disk_cache.is_enabled()) return convert_triangle_list(msg, chunk_size).to_array();
+  // chunk_size does not change the result
+  const uint64_t key = DiskCache::hash_bytes(ns.data(), ns.size(), DiskCache::hash_message(msg));
+  return disk_cache.get_or_convert<Array>(
+    key, [&]() { return convert_triangle_list(msg, chunk_size).to_array(); });
+}
 }  // namespace
 
+MarkerArray::MarkerArray()
+: disk_cache_(std::make_shared<DiskCache>("marker_array")), state_(std::make_shared<SharedState>())
+{
+  message_hook_ = [state = state_, disk_cache = disk_cache_](const ConstSharedPtr & msg) {
+    const auto changed = state->store.apply(*msg, MarkerStore::Clock::now());
+    for (const auto & ns : changed) {
+      bool precompute = false;
+      {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        precompute = state->precompute_namespaces.count(ns) > 0;
+      }
+      if (precompute) build_triangle_list(*state, *disk_cache, ns);
+    }
+  };
+}
+
+Array MarkerArray::build_triangle_list(
+  SharedState & state, const DiskCache & disk_cache, const std::string & ns)
+{
+  const auto snapshot = state.store.get_namespace(ns);
+  {
+    std::lock_guard<std::mutex> lock(state.mutex);
+    const auto it = state.triangle_lists.find(ns);
+    if (it != state.triangle_lists.end() && it->second.revision == snapshot.revision) {
+      return it->second.triangle_list;
+    }
+  }
+
+  const Array triangle_list =
+    convert_triangle_list_cached(disk_cache, *snapshot.markers, ns, state.chunk_size);
+  std::lock_guard<std::mutex> lock(state.mutex);
+  auto & cache = state.triangle_lists[ns];
+  // Another thread may have stored a newer revision meanwhile
+  if (cache.revision <= snapshot.revision) cache = {snapshot.revision, triangle_list};
+  return triangle_list;
+}
+
 void MarkerArray::_bind_methods()
 {
   ClassDB::bind_method(D_METHOD("get_triangle_list"), &MarkerArray::get_triangle_list);
+  ClassDB::bind_method(
+    D_METHOD("get_triangle_list_arrays", "ns"), &MarkerArray::get_triangle_list_arrays);
+  ClassDB::bind_method(
+    D_METHOD("get_merged_triangle_list_arrays", "namespaces"),
+    &MarkerArray::get_merged_triangle_list_arrays);
+  ClassDB::bind_method(
+    D_METHOD("get_tiled_triangle_list_arrays", "namespaces", "tile_size"),
+    &MarkerArray::get_tiled_triangle_list_arrays, DEFVAL(100.0));
   ClassDB::bind_method(D_METHOD("get_color_spheres"), &MarkerArray::get_color_spheres);
+  ClassDB::bind_method(
+    D_METHOD("get_sphere_instances", "ns"), &MarkerArray::get_sphere_instances);
+  ClassDB::bind_method(D_METHOD("get_cube_instances", "ns"), &MarkerArray::get_cube_instances);
+  ClassDB::bind_method(
+    D_METHOD("get_line_list_arrays", "ns"), &MarkerArray::get_line_list_arrays);
+  ClassDB::bind_method(
+    D_METHOD("update_multimesh", "ns", "sphere_multimesh", "cube_multimesh"),
+    &MarkerArray::update_multimesh);
+  ClassDB::bind_method(
+    D_METHOD("has_new_in_namespace", "ns"), &MarkerArray::has_new_in_namespace);
+  ClassDB::bind_method(
+    D_METHOD("set_old_in_namespace", "ns"), &MarkerArray::set_old_in_namespace);
+  ClassDB::bind_method(
+    D_METHOD("enable_precompute", "namespaces"), &MarkerArray::enable_precompute);
+  ClassDB::bind_method(D_METHOD("disable_precompute"), &MarkerArray::disable_precompute);
+  ClassDB::bind_method(D_METHOD("set_disk_cache", "enabled"), &MarkerArray::set_disk_cache);
+  ClassDB::bind_method(D_METHOD("is_disk_cache_enabled"), &MarkerArray::is_disk_cache_enabled);
+  ADD_PROPERTY(
+    PropertyInfo(Variant::BOOL, "disk_cache"), "set_disk_cache", "is_disk_cache_enabled");
+  ClassDB::bind_method(D_METHOD("set_chunk_size", "chunk_size"), &MarkerArray::set_chunk_size);
+  ClassDB::bind_method(D_METHOD("get_chunk_size"), &MarkerArray::get_chunk_size);
+  ADD_PROPERTY(PropertyInfo(Variant::INT, "chunk_size"), "set_chunk_size", "get_chunk_size");
   TOPIC_SUBSCRIBER_BIND_METHODS(MarkerArray);
 }
 
+void MarkerArray::enable_precompute(const PackedStringArray & namespaces)
+{
+  std::lock_guard<std::mutex> lock(state_->mutex);
+  state_->precompute_namespaces.clear();
+  for (const auto & ns : namespaces) {
+    state_->precompute_namespaces.insert(to_std(ns));
+  }
+}
+
+void MarkerArray::disable_precompute()
+{
+  std::lock_guard<std::mutex> lock(state_->mutex);
+  state_->precompute_namespaces.clear();
+}
+
+void MarkerArray::set_disk_cache(const bool enabled) { disk_cache_->set_enabled(enabled); }
+
+void MarkerArray::set_chunk_size(const int chunk_size)
+{
+  state_->chunk_size = std::max(chunk_size, 0);
+}
+
+int MarkerArray::get_chunk_size() const { return state_->chunk_size; }
+
 Array MarkerArray::get_triangle_list(const String & ns)
 {
-  Array triangle_list;
-
-  const auto last_msg = get_last_msg();
-  if (!last_msg) return triangle_list;
-
-  for (const auto & marker : last_msg.value()->markers) {
-    if (to_std(ns) == marker.ns && marker.type == Type::TRIANGLE_LIST) {
-      const auto & points = marker.points;
-      for (size_t i = 2; i < points.size(); i += 3) {
-        const std::array<Eigen::Vector4f, 3> local_vertices = {
-          Eigen::Vector4f{points[i - 2].x, points[i - 2].y, points[i - 2].z, 1},
-          Eigen::Vector4f{points[i - 1].x, points[i - 1].y, points[i - 1].z, 1},
-          Eigen::Vector4f{points[i].x, points[i].y, points[i].z, 1}};
-
-        std::array<Eigen::Vector4f, 3> vertices;
-        if (has_origin_pose(marker)) {
-          const auto & pos = marker.pose.position;
-          const auto & quat = marker.pose.orientation;
-          Eigen::Translation3f translation(pos.x, pos.y, pos.z);
-          Eigen::Quaternionf quaternion(quat.w, quat.x, quat.y, quat.z);
-          Eigen::Matrix4f transform = (translation * quaternion).matrix();
-          std::array<Eigen::Vector4f, 3> global_vertices{
-            transform * local_vertices[0], transform * local_vertices[1],
-            transform * local_vertices[2]};
-          vertices = global_vertices;
-        } else {
-          vertices = local_vertices;
-        }
-
-        const auto normal = cross_product(
-                              vertices[2].head<3>() - vertices[0].head<3>(),
-                              vertices[1].head<3>() - vertices[0].head<3>())
-                              .normalized();
-
-        {
-          Dictionary triangle_point;
-          triangle_point["position"] =
-            ros2_to_godot(vertices[0][0], vertices[0][1], vertices[0][2]);
-          triangle_point["normal"] = ros2_to_godot(normal[0], normal[1], normal[2]);
-          triangle_list.append(triangle_point);
-        }
-        {
-          Dictionary triangle_point;
-          triangle_point["position"] =
-            ros2_to_godot(vertices[1][0], vertices[1][1], vertices[1][2]);
-          triangle_point["normal"] = ros2_to_godot(normal[0], normal[1], normal[2]);
-          triangle_list.append(triangle_point);
-        }
-        {
-          Dictionary triangle_point;
-          triangle_point["position"] =
-            ros2_to_godot(vertices[2][0], vertices[2][1], vertices[2][2]);
-          triangle_point["normal"] = ros2_to_godot(normal[0], normal[1], normal[2]);
-          triangle_list.append(triangle_point);
-        }
-      }
+  const auto timer = measure_conversion("get_triangle_list");
+  return MeshArrays::from_array(get_triangle_list_arrays(ns)).to_point_dicts();
+}
+
+Array MarkerArray::get_triangle_list_arrays(const String & ns)
+{
+  const auto timer = measure_conversion("get_triangle_list_arrays");
+  state_->store.expire(MarkerStore::Clock::now());
+  // A fresh container, since scripts may modify it; the packed arrays are shared with the cache
+  return build_triangle_list(*state_, *disk_cache_, to_std(ns)).duplicate();
+}
+
+Array MarkerArray::get_merged_triangle_list_arrays(const PackedStringArray & namespaces)
+{
+  const auto timer = measure_conversion("get_merged_triangle_list_arrays");
+  state_->store.expire(MarkerStore::Clock::now());
+  std::vector<MeshArrays> triangle_lists;
+  triangle_lists.reserve(namespaces.size());
+  for (const auto & ns : namespaces) {
+    triangle_lists.push_back(
+      MeshArrays::from_array(build_triangle_list(*state_, *disk_cache_, to_std(ns))));
+  }
+  return MeshArrays::concatenate(triangle_lists).to_array();
+}
+
+Array MarkerArray::get_tiled_triangle_list_arrays(
+  const PackedStringArray & namespaces, const float tile_size)
+{
+  const auto timer = measure_conversion("get_tiled_triangle_list_arrays");
+  state_->store.expire(MarkerStore::Clock::now());
+
+  // Split the merged triangle lists again only if a namespace or the tile size changed
+  std::vector<uint64_t> revisions;
+  revisions.reserve(namespaces.size());
+  for (const auto & ns : namespaces) {
+    revisions.push_back(state_->store.get_revision(to_std(ns)));
+  }
+  if (
+    tile_cache_.namespaces != namespaces || tile_cache_.revisions != revisions ||
+    tile_cache_.tile_size != tile_size) {
+    std::vector<MeshArrays> triangle_lists;
+    triangle_lists.reserve(namespaces.size());
+    for (const auto & ns : namespaces) {
+      triangle_lists.push_back(
+        MeshArrays::from_array(build_triangle_list(*state_, *disk_cache_, to_std(ns))));
     }
+    tile_cache_ = {
+      namespaces, std::move(revisions), tile_size,
+      MeshArrays::concatenate(triangle_lists).split_into_tiles(tile_size)};
   }
 
-  return triangle_list;
+  // Fresh containers every call, so scripts may modify them; the packed arrays are shared
+  Array tiles;
+  tiles.resize(tile_cache_.tiles.size());
+  for (size_t i = 0; i < tile_cache_.tiles.size(); ++i) {
+    const auto & tile = tile_cache_.tiles[i];
+    Dictionary tile_dict;
+    tile_dict["arrays"] = tile.arrays.to_array();
+    tile_dict["aabb"] = tile.aabb;
+    tile_dict["tile"] = tile.tile;
+    tiles[i] = tile_dict;
+  }
+  return tiles;
+}
+
+bool MarkerArray::has_new_in_namespace(const String & ns)
+{
+  state_->store.expire(MarkerStore::Clock::now());
+  const std::string ns_std = to_std(ns);
+  const auto it = consumed_revisions_.find(ns_std);
+  const uint64_t consumed_revision = it == consumed_revisions_.end() ? 0 : it->second;
+  return state_->store.get_revision(ns_std) != consumed_revision;
+}
+
+void MarkerArray::set_old_in_namespace(const String & ns)
+{
+  const std::string ns_std = to_std(ns);
+  consumed_revisions_[ns_std] = state_->store.get_revision(ns_std);
 }
 
 Array MarkerArray::get_color_spheres(const String & ns)
 {
+  const auto timer = measure_conversion("get_color_spheres");
   Array color_spheres;
-  const auto last_msg = get_last_msg();
-  if (!last_msg) return color_spheres;
+  state_->store.expire(MarkerStore::Clock::now());
+  const auto snapshot = state_->store.get_namespace(to_std(ns));
 
-  for (const auto & marker : last_msg.value()->markers) {
-    if (to_std(ns) == marker.ns && marker.type == Type::SPHERE) {
-      Array color_sphere;
+  const auto append_color_sphere = [&color_spheres](
+                                     const Color & color, const Vector3 & position,
+                                     const Vector3 & size) {
+    Array color_sphere;
+    color_sphere.append(color);
+    color_sphere.append(position);
+    color_sphere.append(Vector3());  // TODO add rotation
+    color_sphere.append(size);
+    color_spheres.append(color_sphere);
+  };
+  for (const auto & marker : snapshot.markers->markers) {
+    const Vector3 size(marker.scale.x, marker.scale.z, marker.scale.y);  // TODO add rotation
+    if (marker.type == Type::SPHERE) {
       Color color(marker.color.r, marker.color.g, marker.color.b, marker.color.a);
-      Vector3 position(ros2_to_godot(marker.pose.position));
-      Vector3 rotation;                                              // TODO add rotation
-      Vector3 size(marker.scale.x, marker.scale.z, marker.scale.y);  // TODO add rotation
-      color_sphere.append(color);
-      color_sphere.append(position);
-      color_sphere.append(rotation);
-      color_sphere.append(size);
-      color_spheres.append(color_sphere);
+      append_color_sphere(color, ros2_to_godot(marker.pose.position), size);
+    } else if (marker.type == Type::SPHERE_LIST) {
+      const Transform3D pose = get_godot_pose(marker);
+      for (size_t i = 0; i < marker.points.size(); ++i) {
+        append_color_sphere(
+          get_point_color(marker, i), pose.xform(ros2_to_godot(marker.points[i])), size);
+      }
     }
-    // TODO implement about SPHERE_LIST
-    // else if (s == marker.ns && marker.type == Type::SPHERE_LIST)
-    // {
-    //   for (const auto &point : marker.points)
-    //   {
-    //     Array color_sphere;
-    //     Color color(marker.color.r, marker.color.g, marker.color.b, marker.color.a);
-    //     Vector3 position(marker.pose.position.x, marker.pose.position.z, -1.0 *
-    //     marker.pose.position.y); Vector3 rotation; color_sphere.append(color);
-    //     color_sphere.append(position);
-    //     color_sphere.append(rotation);
-    //     color_spheres.append(color_sphere);
-    //   }
-    // }
   }
 
   return color_spheres;
 }
+
+Dictionary MarkerArray::get_sphere_instances(const String & ns)
+{
+  const auto timer = measure_conversion("get_sphere_instances");
+  state_->store.expire(MarkerStore::Clock::now());
+  const auto snapshot = state_->store.get_namespace(to_std(ns));
+  return convert_instances(*snapshot.markers, Type::SPHERE, Type::SPHERE_LIST).to_dict();
+}
+
+Dictionary MarkerArray::get_cube_instances(const String & ns)
+{
+  const auto timer = measure_conversion("get_cube_instances");
+  state_->store.expire(MarkerStore::Clock::now());
+  const auto snapshot = state_->store.get_namespace(to_std(ns));
+  return convert_instances(*snapshot.markers, Type::CUBE, Type::CUBE_LIST).to_dict();
+}
+
+Array MarkerArray::get_line_list_arrays(const String & ns)
+{
+  const auto timer = measure_conversion("get_line_list_arrays");
+  state_->store.expire(MarkerStore::Clock::now());
+  const auto snapshot = state_->store.get_namespace(to_std(ns));
+  return convert_line_list(*snapshot.markers).to_array();
+}
+
+void MarkerArray::update_multimesh(
+  const String & ns, const Ref<MultiMesh> & sphere_multimesh, const Ref<MultiMesh> & cube_multimesh)
+{
+  const auto timer = measure_conversion("update_multimesh");
+  state_->store.expire(MarkerStore::Clock::now());
+  const auto snapshot = state_->store.get_namespace(to_std(ns));
+  if (sphere_multimesh.is_valid()) {
+    const auto instances = convert_instances(*snapshot.markers, Type::SPHERE, Type::SPHERE_LIST);
+    instances.write_to(sphere_multimesh);
+  }
+  if (cube_multimesh.is_valid()) {
+    const auto instances = convert_instances(*snapshot.markers, Type::CUBE, Type::CUBE_LIST);
+    instances.write_to(cube_multimesh);
+  }
+}
@@ -0,0 +1,128 @@
+//
+//  Copyright 2022 Yukihiro Saito. All rights reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#include "marker_store.hpp"
+
+#include <algorithm>
+
+using Marker = visualization_msgs::msg::Marker;
+
+void MarkerStore::touch(
+  const std::string & ns, Namespace & markers, std::vector<std::string> & changed)
+{
+  markers.revision = next_revision_++;
+  markers.snapshot.reset();
+  if (std::find(changed.begin(), changed.end(), ns) == changed.end()) changed.push_back(ns);
+}
+
+std::vector<std::string> MarkerStore::apply(
+  const visualization_msgs::msg::MarkerArray & msg, const Clock::time_point now)
+{
+  std::vector<std::string> changed;
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  for (const auto & marker : msg.markers) {
+    switch (marker.action) {
+      case Marker::ADD: {
+        auto & markers = namespaces_[marker.ns];
+        auto & stored = markers.markers[marker.id];
+        stored.marker = marker;
+        stored.expiry.reset();
+        const auto & lifetime = marker.lifetime;
+        if (lifetime.sec != 0 || lifetime.nanosec != 0) {
+          stored.expiry = now + std::chrono::duration_cast<Clock::duration>(
+                                  std::chrono::seconds(lifetime.sec) +
+                                  std::chrono::nanoseconds(lifetime.nanosec));
+          if (!next_expiry_ || *stored.expiry < *next_expiry_) next_expiry_ = stored.expiry;
+        }
+        touch(marker.ns, markers, changed);
+        break;
+      }
+      case Marker::DELETE: {
+        const auto it = namespaces_.find(marker.ns);
+        if (it != namespaces_.end() && it->second.markers.erase(marker.id) > 0) {
+          touch(marker.ns, it->second, changed);
+        }
+        break;
+      }
+      case Marker::DELETEALL: {
+        for (auto & [ns, markers] : namespaces_) {
+          if (!marker.ns.empty() && ns != marker.ns) continue;
+          if (markers.markers.empty()) continue;
+          markers.markers.clear();
+          touch(ns, markers, changed);
+        }
+        break;
+      }
+      default:
+        break;
+    }
+  }
+
+  return changed;
+}
+
+std::vector<std::string> MarkerStore::expire(const Clock::time_point now)
+{
+  std::vector<std::string> changed;
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!next_expiry_ || now < *next_expiry_) return changed;
+
+  next_expiry_.reset();
+  for (auto & [ns, markers] : namespaces_) {
+    bool erased = false;
+    for (auto it = markers.markers.begin(); it != markers.markers.end();) {
+      const auto & expiry = it->second.expiry;
+      if (expiry && *expiry <= now) {
+        it = markers.markers.erase(it);
+        erased = true;
+        continue;
+      }
+      if (expiry && (!next_expiry_ || *expiry < *next_expiry_)) next_expiry_ = expiry;
+      ++it;
+    }
+    if (erased) touch(ns, markers, changed);
+  }
+
+  return changed;
+}
+
+MarkerStore::NamespaceSnapshot MarkerStore::get_namespace(const std::string & ns)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  const auto it = namespaces_.find(ns);
+  if (it == namespaces_.end()) {
+    return {0, std::make_shared<const visualization_msgs::msg::MarkerArray>()};
+  }
+
+  auto & markers = it->second;
+  if (!markers.snapshot) {
+    auto snapshot = std::make_shared<visualization_msgs::msg::MarkerArray>();
+    snapshot->markers.reserve(markers.markers.size());
+    for (const auto & [id, stored] : markers.markers) {
+      snapshot->markers.push_back(stored.marker);
+    }
+    markers.snapshot = snapshot;
+  }
+  return {markers.revision, markers.snapshot};
+}
+
+uint64_t MarkerStore::get_revision(const std::string & ns) const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  const auto it = namespaces_.find(ns);
+  return it == namespaces_.end() ? 0 : it->second.revision;
+}
@@ -0,0 +1,308 @@
+//
+//  Copyright 2022 Yukihiro Saito. All rights reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#include "mesh_arrays.hpp"
+
+#include "scene/resources/mesh.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <type_traits>
+#include <utility>
+
+Array MeshArrays::to_array() const
+{
+  Array array;
+  array.resize(Mesh::ARRAY_MAX);
+  if (!vertices.is_empty()) array[Mesh::ARRAY_VERTEX] = vertices;
+  if (!normals.is_empty()) array[Mesh::ARRAY_NORMAL] = normals;
+  if (!colors.is_empty()) array[Mesh::ARRAY_COLOR] = colors;
+  if (!velocities.is_empty()) array[Mesh::ARRAY_CUSTOM0] = velocities;
+  if (!indices.is_empty()) array[Mesh::ARRAY_INDEX] = indices;
+  return array;
+}
+
+namespace
+{
+/**
+ * @brief Gathers the elements of a channel in index order.
+ */
+template <class PackedT>
+PackedT expand_channel(const PackedT & channel, const PackedInt32Array & indices)
+{
+  PackedT expanded;
+  if (channel.is_empty()) return expanded;
+  expanded.resize(indices.size());
+  auto * dst = expanded.ptrw();
+  const auto * src = channel.ptr();
+  const int32_t * index = indices.ptr();
+  for (int i = 0; i < indices.size(); ++i) {
+    dst[i] = src[index[i]];
+  }
+  return expanded;
+}
+
+/**
+ * @brief Copies a channel of every part into one preallocated channel.
+ */
+template <class PackedT>
+PackedT concatenate_channel(
+  const std::vector<MeshArrays> & parts, PackedT MeshArrays::*channel, const int size)
+{
+  PackedT concatenated;
+  concatenated.resize(size);
+  auto * dst = concatenated.ptrw();
+  for (const auto & part : parts) {
+    const PackedT & src = part.*channel;
+    std::copy(src.ptr(), src.ptr() + src.size(), dst);
+    dst += src.size();
+  }
+  return concatenated;
+}
+
+/**
+ * @brief Checks whether every non-empty part has a complete channel.
+ */
+template <class PackedT>
+bool has_channel(const std::vector<MeshArrays> & parts, PackedT MeshArrays::*channel)
+{
+  bool found = false;
+  for (const auto & part : parts) {
+    if (part.size() == 0) continue;
+    if ((part.*channel).size() != part.size()) return false;
+    found = true;
+  }
+  return found;
+}
+
+/**
+ * @brief Copies the triangles of each tile out of a channel, if the channel has one element per
+ * vertex.
+ *
+ * @param channel The channel of the source mesh.
+ * @param num_vertices The number of vertices of the source mesh.
+ * @param triangle_tiles Tile index of each triangle.
+ * @param tiles The tiles, with the vertex channel already sized.
+ * @param member The channel in MeshArrays.
+ */
+template <class PackedT>
+void split_channel(
+  const PackedT & channel, const int num_vertices, const std::vector<int> & triangle_tiles,
+  std::vector<MeshTile> & tiles, PackedT MeshArrays::*member)
+{
+  if (channel.size() != num_vertices) return;
+  std::vector<std::decay_t<decltype(channel[0])> *> cursors;
+  cursors.reserve(tiles.size());
+  for (auto & tile : tiles) {
+    (tile.arrays.*member).resize(tile.arrays.vertices.size());
+    cursors.push_back((tile.arrays.*member).ptrw());
+  }
+  const auto * src = channel.ptr();
+  for (size_t t = 0; t < triangle_tiles.size(); ++t) {
+    auto *& dst = cursors[triangle_tiles[t]];
+    *dst++ = src[3 * t];
+    *dst++ = src[3 * t + 1];
+    *dst++ = src[3 * t + 2];
+  }
+}
+
+/**
+ * @brief Copies a float buffer with a number of floats per element into a packed array.
+ */
+template <class PackedT, int components>
+PackedT from_float_buffer(const std::vector<float> & buffer)
+{
+  PackedT packed;
+  const int size = buffer.size() / components;
+  if (size == 0) return packed;
+  packed.resize(size);
+  auto * dst = packed.ptrw();
+  // real_t may be double, so only copy bytes when the layouts match
+  if constexpr (sizeof(*dst) == sizeof(float) * components) {
+    std::memcpy(dst, buffer.data(), sizeof(float) * buffer.size());
+  } else {
+    for (int i = 0; i < size; ++i) {
+      for (int j = 0; j < components; ++j) {
+        dst[i][j] = buffer[components * i + j];
+      }
+    }
+  }
+  return packed;
+}
+}  // namespace
+
+MeshArrays MeshArrays::expand_indices() const
+{
+  if (indices.is_empty()) return *this;
+
+  MeshArrays expanded;
+  expanded.vertices = expand_channel(vertices, indices);
+  expanded.normals = expand_channel(normals, indices);
+  expanded.colors = expand_channel(colors, indices);
+  expanded.velocities = expand_channel(velocities, indices);
+  return expanded;
+}
+
+Array MeshArrays::to_point_dicts() const
+{
+  if (!indices.is_empty()) return expand_indices().to_point_dicts();
+
+  Array point_dicts;
+  point_dicts.resize(vertices.size());
+  for (int i = 0; i < vertices.size(); ++i) {
+    Dictionary point_dict;
+    point_dict["position"] = vertices[i];
+    if (i < normals.size()) point_dict["normal"] = normals[i];
+    if (i < colors.size()) point_dict["color"] = colors[i];
+    if (i < velocities.size()) point_dict["velocity"] = velocities[i];
+    point_dicts[i] = point_dict;
+  }
+  return point_dicts;
+}
+
+MeshArrays MeshArrays::from_array(const Array & array)
+{
+  MeshArrays mesh_arrays;
+  if (array.size() != Mesh::ARRAY_MAX) return mesh_arrays;
+  mesh_arrays.vertices = array[Mesh::ARRAY_VERTEX];
+  mesh_arrays.normals = array[Mesh::ARRAY_NORMAL];
+  mesh_arrays.colors = array[Mesh::ARRAY_COLOR];
+  mesh_arrays.velocities = array[Mesh::ARRAY_CUSTOM0];
+  mesh_arrays.indices = array[Mesh::ARRAY_INDEX];
+  return mesh_arrays;
+}
+
+MeshArrays MeshArrays::concatenate(const std::vector<MeshArrays> & parts)
+{
+  bool all_indexed = true;
+  bool any_indexed = false;
+  for (const auto & part : parts) {
+    if (part.size() == 0) continue;
+    all_indexed &= !part.indices.is_empty();
+    any_indexed |= !part.indices.is_empty();
+  }
+  if (any_indexed && !all_indexed) {
+    std::vector<MeshArrays> expanded;
+    expanded.reserve(parts.size());
+    for (const auto & part : parts) {
+      expanded.push_back(part.expand_indices());
+    }
+    return concatenate(expanded);
+  }
+
+  int vertex_count = 0;
+  int index_count = 0;
+  for (const auto & part : parts) {
+    vertex_count += part.size();
+    index_count += part.indices.size();
+  }
+
+  MeshArrays concatenated;
+  if (vertex_count == 0) return concatenated;
+  concatenated.vertices = concatenate_channel(parts, &MeshArrays::vertices, vertex_count);
+  if (has_channel(parts, &MeshArrays::normals)) {
+    concatenated.normals = concatenate_channel(parts, &MeshArrays::normals, vertex_count);
+  }
+  if (has_channel(parts, &MeshArrays::colors)) {
+    concatenated.colors = concatenate_channel(parts, &MeshArrays::colors, vertex_count);
+  }
+  if (has_channel(parts, &MeshArrays::velocities)) {
+    concatenated.velocities = concatenate_channel(parts, &MeshArrays::velocities, vertex_count);
+  }
+
+  if (all_indexed) {
+    concatenated.indices.resize(index_count);
+    int32_t * dst = concatenated.indices.ptrw();
+    int32_t offset = 0;
+    for (const auto & part : parts) {
+      const int32_t * src = part.indices.ptr();
+      for (int i = 0; i < part.indices.size(); ++i) {
+        *dst++ = src[i] + offset;
+      }
+      offset += part.size();
+    }
+  }
+  return concatenated;
+}
+
+MeshArrays MeshArrays::from_buffers(const rviz_core::MeshBuffers & buffers)
+{
+  MeshArrays arrays;
+  arrays.vertices = from_float_buffer<PackedVector3Array, 3>(buffers.vertices);
+  arrays.normals = from_float_buffer<PackedVector3Array, 3>(buffers.normals);
+  arrays.colors = from_float_buffer<PackedColorArray, 4>(buffers.colors);
+  arrays.velocities.resize(buffers.velocities.size());
+  std::copy(buffers.velocities.begin(), buffers.velocities.end(), arrays.velocities.ptrw());
+  arrays.indices.resize(buffers.indices.size());
+  std::copy(buffers.indices.begin(), buffers.indices.end(), arrays.indices.ptrw());
+  return arrays;
+}
+
+std::vector<MeshTile> MeshArrays::split_into_tiles(const float tile_size) const
+{
+  if (!indices.is_empty()) return expand_indices().split_into_tiles(tile_size);
+
+  std::vector<MeshTile> tiles;
+  const int num_triangles = vertices.size() / 3;
+  if (num_triangles == 0 || !(tile_size > 0)) return tiles;
+
+  // Find the tile of each triangle's centroid, numbering the tiles in order
+  const Vector3 * src = vertices.ptr();
+  std::vector<std::pair<int, int>> triangle_keys(num_triangles);
+  std::map<std::pair<int, int>, int> tile_indices;
+  for (int t = 0; t < num_triangles; ++t) {
+    const Vector3 centroid = (src[3 * t] + src[3 * t + 1] + src[3 * t + 2]) / 3;
+    triangle_keys[t] = {
+      static_cast<int>(std::floor(centroid.x / tile_size)),
+      static_cast<int>(std::floor(centroid.z / tile_size))};
+    tile_indices.emplace(triangle_keys[t], 0);
+  }
+  tiles.resize(tile_indices.size());
+  int index = 0;
+  for (auto & [key, tile_index] : tile_indices) {
+    tiles[index].tile = Vector2i(key.first, key.second);
+    tile_index = index++;
+  }
+
+  // Count the triangles of each tile to allocate every channel once
+  std::vector<int> triangle_tiles(num_triangles);
+  std::vector<int> tile_sizes(tiles.size(), 0);
+  for (int t = 0; t < num_triangles; ++t) {
+    triangle_tiles[t] = tile_indices.at(triangle_keys[t]);
+    tile_sizes[triangle_tiles[t]] += 3;
+  }
+  for (size_t i = 0; i < tiles.size(); ++i) {
+    tiles[i].arrays.vertices.resize(tile_sizes[i]);
+  }
+
+  // Leftover vertices of an incomplete triangle are dropped
+  const int num_vertices = vertices.size();
+  split_channel(vertices, num_vertices, triangle_tiles, tiles, &MeshArrays::vertices);
+  split_channel(normals, num_vertices, triangle_tiles, tiles, &MeshArrays::normals);
+  split_channel(colors, num_vertices, triangle_tiles, tiles, &MeshArrays::colors);
+  split_channel(velocities, num_vertices, triangle_tiles, tiles, &MeshArrays::velocities);
+
+  for (auto & tile : tiles) {
+    const Vector3 * tile_vertices = tile.arrays.vertices.ptr();
+    tile.aabb = AABB(tile_vertices[0], Vector3());
+    for (int i = 1; i < tile.arrays.vertices.size(); ++i) {
+      tile.aabb.expand_to(tile_vertices[i]);
+    }
+  }
+  return tiles;
+}
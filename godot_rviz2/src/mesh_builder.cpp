@@ -0,0 +1,226 @@
+//
+//  Copyright 2022 Yukihiro Saito. All rights reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#include "mesh_builder.hpp"
+
+#include "servers/rendering_server.h"
+
+#include <algorithm>
+#include <type_traits>
+
+namespace
+{
+/**
+ * @brief Pads a vertex channel to the capacity by repeating the elements of its last vertex.
+ *
+ * @param channel The channel.
+ * @param vertex_count Number of vertices in the channel.
+ * @param capacity Number of vertices after padding.
+ */
+template <class PackedT>
+Variant pad_channel(const Variant & channel, const int vertex_count, const int capacity)
+{
+  using ValueT = std::remove_pointer_t<decltype(PackedT().ptrw())>;
+  PackedT data = channel;
+  // Channels such as tangents or bone weights store several elements per vertex
+  const int stride = vertex_count > 0 ? data.size() / vertex_count : 1;
+  const int size = vertex_count * stride;
+  data.resize(capacity * stride);
+  ValueT * ptr = data.ptrw();
+  for (int i = size; i < capacity * stride; ++i) {
+    ptr[i] = size > 0 ? ptr[size - stride + (i - size) % stride] : ValueT();
+  }
+  return data;
+}
+
+/**
+ * @brief Pads all the vertex channels of surface arrays to the capacity.
+ *
+ * @param arrays The surface arrays.
+ * @param capacity Number of vertices after padding.
+ * @return Array The padded arrays. The index channel is kept as it is.
+ */
+Array pad_arrays(const Array & arrays, const int capacity)
+{
+  Array padded;
+  padded.resize(Mesh::ARRAY_MAX);
+  const PackedVector3Array vertices = arrays[Mesh::ARRAY_VERTEX];
+  const int vertex_count = vertices.size();
+  for (int i = 0; i < Mesh::ARRAY_MAX; ++i) {
+    const Variant & channel = arrays[i];
+    if (i == Mesh::ARRAY_INDEX) {
+      padded[i] = channel;
+      continue;
+    }
+    switch (channel.get_type()) {
+      case Variant::PACKED_VECTOR3_ARRAY:
+        padded[i] = pad_channel<PackedVector3Array>(channel, vertex_count, capacity);
+        break;
+      case Variant::PACKED_VECTOR2_ARRAY:
+        padded[i] = pad_channel<PackedVector2Array>(channel, vertex_count, capacity);
+        break;
+      case Variant::PACKED_COLOR_ARRAY:
+        padded[i] = pad_channel<PackedColorArray>(channel, vertex_count, capacity);
+        break;
+      case Variant::PACKED_FLOAT32_ARRAY:
+        padded[i] = pad_channel<PackedFloat32Array>(channel, vertex_count, capacity);
+        break;
+      case Variant::PACKED_FLOAT64_ARRAY:
+        padded[i] = pad_channel<PackedFloat64Array>(channel, vertex_count, capacity);
+        break;
+      case Variant::PACKED_INT32_ARRAY:
+        padded[i] = pad_channel<PackedInt32Array>(channel, vertex_count, capacity);
+        break;
+      case Variant::PACKED_BYTE_ARRAY:
+        padded[i] = pad_channel<PackedByteArray>(channel, vertex_count, capacity);
+        break;
+      default:
+        break;
+    }
+  }
+  // Surfaces always need vertices, even if there is nothing to draw
+  if (vertex_count == 0) {
+    PackedVector3Array empty_vertices;
+    empty_vertices.resize(capacity);
+    empty_vertices.fill(Vector3());
+    padded[Mesh::ARRAY_VERTEX] = empty_vertices;
+  }
+  return padded;
+}
+}  // namespace
+
+MeshBuilder::MeshBuilder() : mesh_(memnew(ArrayMesh)) {}
+
+void MeshBuilder::_bind_methods()
+{
+  ClassDB::bind_method(
+    D_METHOD("update_surface", "surface", "primitive", "arrays", "flags"),
+    &MeshBuilder::update_surface, DEFVAL(0));
+  ClassDB::bind_method(D_METHOD("clear_surface", "surface"), &MeshBuilder::clear_surface);
+  ClassDB::bind_method(D_METHOD("clear"), &MeshBuilder::clear);
+  ClassDB::bind_method(
+    D_METHOD("get_surface_capacity", "surface"), &MeshBuilder::get_surface_capacity);
+  ClassDB::bind_method(D_METHOD("get_mesh"), &MeshBuilder::get_mesh);
+  ClassDB::bind_method(D_METHOD("attach", "mesh_instance"), &MeshBuilder::attach);
+}
+
+void MeshBuilder::update_surface(
+  const int surface, const Mesh::PrimitiveType primitive, const Array & arrays,
+  const int64_t flags)
+{
+  if (surface < 0 || surface > static_cast<int>(surfaces_.size())) return;
+  if (arrays.size() != Mesh::ARRAY_MAX) return;
+
+  const PackedVector3Array vertices = arrays[Mesh::ARRAY_VERTEX];
+  const int vertex_count = vertices.size();
+  const bool is_new = surface == static_cast<int>(surfaces_.size());
+  if (is_new) surfaces_.emplace_back();
+
+  auto & target = surfaces_[surface];
+  bool needs_rebuild = is_new || target.primitive != primitive || target.flags != flags ||
+                       vertex_count > target.capacity ||
+                       arrays[Mesh::ARRAY_INDEX].get_type() != Variant::NIL;
+  // New surfaces start at the minimum capacity even when they are empty, since a surface without
+  // vertices cannot be created
+  const int capacity = is_new || vertex_count > target.capacity
+                         ? std::max<int>(next_power_of_2(vertex_count), min_capacity)
+                         : target.capacity;
+  const Array padded = pad_arrays(arrays, capacity);
+
+  RenderingServer::SurfaceData surface_data;
+  const Error error = RenderingServer::get_singleton()->mesh_create_surface_data_from_arrays(
+    &surface_data, static_cast<RenderingServer::PrimitiveType>(primitive), padded, Array(),
+    Dictionary(), flags);
+  if (error != OK) {
+    // Keep invalid arrays out of the surfaces that rebuild adds again
+    if (is_new) surfaces_.pop_back();
+    return;
+  }
+  target.capacity = capacity;
+  target.primitive = primitive;
+  target.flags = flags;
+  target.arrays = padded;
+  target.aabb = vertex_count > 0 ? surface_data.aabb : AABB();
+
+  // A changed set of channels changes the buffer layout
+  needs_rebuild =
+    needs_rebuild || mesh_->get_surface_count() <= surface ||
+    surface_data.format != static_cast<uint64_t>(int64_t(mesh_->surface_get_format(surface)));
+  if (needs_rebuild) {
+    rebuild();
+  } else {
+    mesh_->surface_update_vertex_region(surface, 0, surface_data.vertex_data);
+    if (!surface_data.attribute_data.is_empty()) {
+      mesh_->surface_update_attribute_region(surface, 0, surface_data.attribute_data);
+    }
+  }
+  update_custom_aabb();
+}
+
+void MeshBuilder::clear_surface(const int surface)
+{
+  if (surface < 0 || surface >= static_cast<int>(surfaces_.size())) return;
+
+  // Collapse every vertex onto one point but keep the other channels, so the format is unchanged
+  const auto & target = surfaces_[surface];
+  Array arrays = target.arrays.duplicate();
+  PackedVector3Array vertices;
+  vertices.resize(target.capacity);
+  vertices.fill(Vector3());
+  arrays[Mesh::ARRAY_VERTEX] = vertices;
+  update_surface(surface, target.primitive, arrays, target.flags);
+}
+
+void MeshBuilder::clear()
+{
+  surfaces_.clear();
+  mesh_->clear_surfaces();
+  mesh_->set_custom_aabb(AABB());
+}
+
+int MeshBuilder::get_surface_capacity(const int surface) const
+{
+  if (surface < 0 || surface >= static_cast<int>(surfaces_.size())) return 0;
+  return surfaces_[surface].capacity;
+}
+
+void MeshBuilder::attach(MeshInstance3D * mesh_instance) const
+{
+  if (mesh_instance == nullptr) return;
+  if (mesh_instance->get_mesh() != mesh_) mesh_instance->set_mesh(mesh_);
+}
+
+void MeshBuilder::rebuild()
+{
+  mesh_->clear_surfaces();
+  for (const auto & surface : surfaces_) {
+    mesh_->add_surface_from_arrays(
+      surface.primitive, surface.arrays, Array(), Dictionary(), surface.flags);
+  }
+}
+
+void MeshBuilder::update_custom_aabb()
+{
+  AABB aabb;
+  bool has_aabb = false;
+  for (const auto & surface : surfaces_) {
+    if (surface.aabb.has_volume() || surface.aabb.has_surface()) {
+      aabb = has_aabb ? aabb.merge(surface.aabb) : surface.aabb;
+      has_aabb = true;
+    }
+  }
+  mesh_->set_custom_aabb(aabb);
+}
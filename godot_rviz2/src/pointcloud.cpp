@@ -16,76 +16,923 @@
 
 #include "pointcloud.hpp"
 
-#include "pcl_ros/transforms.hpp"
+#include "core/object/worker_thread_pool.h"
 #include "tf2_eigen/tf2_eigen.h"
 #include "util.hpp"
 
 #include "sensor_msgs/msg/point_field.hpp"
 #include "sensor_msgs/point_cloud2_iterator.hpp"
 
-void PointCloud::_bind_methods()
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#if defined(__SSE2__) && !defined(REAL_T_IS_DOUBLE)
+#include <xmmintrin.h>
+#define GODOT_RVIZ2_POINTCLOUD_SSE
+#endif
+
+namespace
 {
-  // Bind the get_pointcloud method to Godot
-  ClassDB::bind_method(D_METHOD("get_pointcloud"), &PointCloud::get_pointcloud);
-  TOPIC_SUBSCRIBER_BIND_METHODS(PointCloud);
+/**
+ * @brief Checks whether the cloud stores x, y and z as little-endian float32 at offsets 0, 4 and 8.
+ *
+ * Any point_step is accepted, so additional fields such as intensity may follow the coordinates.
+ *
+ * @param msg The point cloud message.
+ * @return bool True if the fast conversion path can be used.
+ */
+bool has_dense_xyz_layout(const sensor_msgs::msg::PointCloud2 & msg)
+{
+  if (msg.is_bigendian || msg.point_step < 3 * sizeof(float)) return false;
+  if (msg.height > 1 && msg.row_step != msg.width * msg.point_step) return false;
+  if (msg.data.size() < static_cast<size_t>(msg.width) * msg.height * msg.point_step) return false;
+
+  const auto has_float_field = [&msg](const std::string & name, const uint32_t offset) {
+    for (const auto & field : msg.fields) {
+      if (field.name == name) {
+        return field.offset == offset && field.count == 1 &&
+               field.datatype == sensor_msgs::msg::PointField::FLOAT32;
+      }
+    }
+    return false;
+  };
+  return has_float_field("x", 0) && has_float_field("y", 4) && has_float_field("z", 8);
+}
+
+/**
+ * @brief Gets the rainbow colormap used for scalar point fields, from blue (0) to red (255).
+ */
+const std::array<Color, 256> & get_rainbow_lut()
+{
+  static const std::array<Color, 256> lut = []() {
+    std::array<Color, 256> colors;
+    for (size_t i = 0; i < colors.size(); ++i) {
+      colors[i] = Color::from_hsv((1.0f - i / 255.0f) * 2.0f / 3.0f, 1.0f, 1.0f);
+    }
+    return colors;
+  }();
+  return lut;
+}
+
+/**
+ * @brief Minimum and maximum of the scalar field values seen in a range of points, skipping NaNs.
+ */
+struct ScalarRange
+{
+  float min = std::numeric_limits<float>::max();
+  float max = std::numeric_limits<float>::lowest();
+
+  void add(const float value)
+  {
+    if (std::isnan(value)) return;
+    min = std::min(min, value);
+    max = std::max(max, value);
+  }
+
+  void merge(const ScalarRange & other)
+  {
+    min = std::min(min, other.min);
+    max = std::max(max, other.max);
+  }
+};
+
+/**
+ * @brief Colors points by one of their fields.
+ *
+ * The field offset and datatype are resolved once per message, so coloring a point costs one
+ * load and one LUT lookup. "rgb" and "rgba" fields are decoded as packed 8-bit colors, "z" colors
+ * by the height in the target frame and any other field is mapped through the rainbow LUT.
+ *
+ * Without a fixed color range, a scalar field is only read during conversion, see
+ * defers_mapping, so the message is still read only once.
+ */
+class PointColorizer
+{
+public:
+  enum class Mode { NONE, PACKED_RGB, SCALAR, HEIGHT };
+
+  PointColorizer(const sensor_msgs::msg::PointCloud2 & msg, const PointCloudConversionParam & param)
+  : range_min_(param.color_min), range_max_(param.color_max)
+  {
+    const std::string field_name = to_std(param.color_field);
+    if (field_name.empty()) return;
+    if (field_name == "z") {
+      mode_ = Mode::HEIGHT;
+      return;
+    }
+    if (msg.is_bigendian || !has_complete_data(msg)) return;
+    for (const auto & field : msg.fields) {
+      if (field.name != field_name) continue;
+      const size_t size = get_field_size(field.datatype);
+      if (size == 0 || field.offset + size > msg.point_step) return;
+      offset_ = field.offset;
+      datatype_ = field.datatype;
+      mode_ = (field_name == "rgb" || field_name == "rgba") ? Mode::PACKED_RGB : Mode::SCALAR;
+      break;
+    }
+  }
+
+  Mode get_mode() const { return mode_; }
+
+  /**
+   * @brief Whether the colors are read from the point data during conversion.
+   */
+  bool decodes_fields() const { return mode_ == Mode::PACKED_RGB || mode_ == Mode::SCALAR; }
+
+  /**
+   * @brief Whether the range of the field is only known after conversion.
+   *
+   * The conversion then stores the raw value of each point in the red channel with read_scalar
+   * and collects their ScalarRange, and map_scalars turns the values into colors.
+   */
+  bool defers_mapping() const { return mode_ == Mode::SCALAR && !has_fixed_range(); }
+
+  /**
+   * @brief Gets the color of a point from its field.
+   *
+   * @param point Pointer to the first byte of the point.
+   */
+  Color get_color(const uint8_t * point) const
+  {
+    if (mode_ == Mode::PACKED_RGB) {
+      uint32_t rgb;
+      std::memcpy(&rgb, point + offset_, sizeof(rgb));
+      return Color(
+        ((rgb >> 16) & 0xff) / 255.0f, ((rgb >> 8) & 0xff) / 255.0f, (rgb & 0xff) / 255.0f);
+    }
+    return map_scalar(read_scalar(point));
+  }
+
+  /**
+   * @brief Colors converted points by their height, i.e. the Godot y coordinate.
+   */
+  void color_by_height(const Vector3 * points, const size_t count, Color * out)
+  {
+    if (!has_fixed_range() && count > 0) {
+      range_min_ = range_max_ = points[0].y;
+      for (size_t i = 1; i < count; ++i) {
+        range_min_ = std::min(range_min_, static_cast<float>(points[i].y));
+        range_max_ = std::max(range_max_, static_cast<float>(points[i].y));
+      }
+    }
+    for (size_t i = 0; i < count; ++i) out[i] = map_scalar(points[i].y);
+  }
+
+  /**
+   * @brief Replaces the raw values stored by a deferred conversion by their colors.
+   *
+   * @param range The range of the values, which becomes the color range.
+   * @param colors Colors holding a raw value in their red channel.
+   * @param count Number of colors.
+   */
+  void map_scalars(const ScalarRange & range, Color * colors, const size_t count)
+  {
+    range_min_ = range.min;
+    range_max_ = range.max;
+    for (size_t i = 0; i < count; ++i) colors[i] = map_scalar(colors[i].r);
+  }
+
+  float read_scalar(const uint8_t * point) const
+  {
+    const uint8_t * field = point + offset_;
+    using sensor_msgs::msg::PointField;
+    switch (datatype_) {
+      case PointField::INT8:
+        return read_as<int8_t>(field);
+      case PointField::UINT8:
+        return read_as<uint8_t>(field);
+      case PointField::INT16:
+        return read_as<int16_t>(field);
+      case PointField::UINT16:
+        return read_as<uint16_t>(field);
+      case PointField::INT32:
+        return read_as<int32_t>(field);
+      case PointField::UINT32:
+        return read_as<uint32_t>(field);
+      case PointField::FLOAT64:
+        return read_as<double>(field);
+      default:
+        return read_as<float>(field);
+    }
+  }
+
+private:
+  Mode mode_ = Mode::NONE;
+  uint32_t offset_ = 0;
+  uint8_t datatype_ = 0;
+  float range_min_;
+  float range_max_;
+
+  bool has_fixed_range() const { return range_min_ < range_max_; }
+
+  static bool has_complete_data(const sensor_msgs::msg::PointCloud2 & msg)
+  {
+    if (msg.width == 0 || msg.height == 0) return true;
+    return msg.data.size() >= static_cast<size_t>(msg.height - 1) * msg.row_step +
+                                static_cast<size_t>(msg.width) * msg.point_step;
+  }
+
+  static size_t get_field_size(const uint8_t datatype)
+  {
+    using sensor_msgs::msg::PointField;
+    switch (datatype) {
+      case PointField::INT8:
+      case PointField::UINT8:
+        return 1;
+      case PointField::INT16:
+      case PointField::UINT16:
+        return 2;
+      case PointField::INT32:
+      case PointField::UINT32:
+      case PointField::FLOAT32:
+        return 4;
+      case PointField::FLOAT64:
+        return 8;
+      default:
+        return 0;
+    }
+  }
+
+  Color map_scalar(const float value) const
+  {
+    const float range = range_max_ - range_min_;
+    const float normalized = range > 0.0f ? (value - range_min_) / range : 0.0f;
+    const int index = static_cast<int>(std::clamp(normalized, 0.0f, 1.0f) * 255.0f + 0.5f);
+    return get_rainbow_lut()[index];
+  }
+
+  template <class T>
+  static float read_as(const uint8_t * field)
+  {
+    T value;
+    std::memcpy(&value, field, sizeof(value));
+    return static_cast<float>(value);
+  }
+};
+
+/**
+ * @brief Color output of the conversion kernels that discards the colors.
+ */
+struct NoColors
+{
+  void operator()(const size_t, const uint8_t *) const {}
+};
+
+/**
+ * @brief Color output of the conversion kernels that decodes each point's field.
+ */
+struct FieldColors
+{
+  const PointColorizer * colorizer;
+  Color * out;
+
+  void operator()(const size_t i, const uint8_t * point) const
+  {
+    out[i] = colorizer->get_color(point);
+  }
+};
+
+/**
+ * @brief Color output of the conversion kernels that stores each point's raw field value, see
+ * PointColorizer::defers_mapping.
+ */
+struct ScalarColors
+{
+  const PointColorizer * colorizer;
+  Color * out;
+  ScalarRange * range;
+
+  void operator()(const size_t i, const uint8_t * point) const
+  {
+    const float value = colorizer->read_scalar(point);
+    out[i] = Color(value, 0.0f, 0.0f, 0.0f);
+    range->add(value);
+  }
+};
+
+/**
+ * @brief Converts densely laid out points to Godot's coordinate system (x, z, -y).
+ *
+ * With SSE each point is read with one 16-byte load, swizzled in a register and written with one
+ * 16-byte store. Both reach 4 bytes past the point; the store is overwritten by the next point, so
+ * only the last point has to be converted by the scalar loop.
+ *
+ * @param data Pointer to the x coordinate of the first point.
+ * @param point_step Size of a point in bytes.
+ * @param count Number of points to convert.
+ * @param out Output array with room for count points.
+ * @param colors Called with the index and the data of each point, in the same loop.
+ */
+template <class ColorsT>
+void convert_dense_xyz(
+  const uint8_t * data, const size_t point_step, const size_t count, Vector3 * out,
+  const ColorsT & colors)
+{
+  size_t i = 0;
+#ifdef GODOT_RVIZ2_POINTCLOUD_SSE
+  float * out_floats = reinterpret_cast<float *>(out);
+  const __m128 negate_y = _mm_set_ps(0.0f, -0.0f, 0.0f, 0.0f);
+  for (; i + 1 < count; ++i) {
+    const uint8_t * point_data = data + i * point_step;
+    __m128 point = _mm_loadu_ps(reinterpret_cast<const float *>(point_data));
+    point = _mm_shuffle_ps(point, point, _MM_SHUFFLE(3, 1, 2, 0));
+    _mm_storeu_ps(out_floats + 3 * i, _mm_xor_ps(point, negate_y));
+    colors(i, point_data);
+  }
+#endif
+  for (; i < count; ++i) {
+    float xyz[3];
+    std::memcpy(xyz, data + i * point_step, sizeof(xyz));
+    out[i] = ros2_to_godot(xyz[0], xyz[1], xyz[2]);
+    colors(i, data + i * point_step);
+  }
 }
 
 /**
- * @brief Transforms a point cloud to a specified target frame.
+ * @brief Transforms densely laid out points and converts them to Godot's coordinate system.
+ *
+ * The matrix already contains the ROS 2 to Godot axis change, so every point costs one 4x4
+ * product. The SSE path uses the same load/store pattern as convert_dense_xyz.
+ *
+ * @param data Pointer to the x coordinate of the first point.
+ * @param point_step Size of a point in bytes.
+ * @param count Number of points to convert.
+ * @param matrix Transform from the message frame to Godot's coordinate system.
+ * @param out Output array with room for count points.
+ * @param colors Called with the index and the data of each point, in the same loop.
+ */
+template <class ColorsT>
+void transform_dense_xyz(
+  const uint8_t * data, const size_t point_step, const size_t count,
+  const Eigen::Matrix4f & matrix, Vector3 * out, const ColorsT & colors)
+{
+  size_t i = 0;
+#ifdef GODOT_RVIZ2_POINTCLOUD_SSE
+  float * out_floats = reinterpret_cast<float *>(out);
+  // Eigen matrices are column-major, so each column is four contiguous floats
+  const __m128 col0 = _mm_loadu_ps(matrix.data());
+  const __m128 col1 = _mm_loadu_ps(matrix.data() + 4);
+  const __m128 col2 = _mm_loadu_ps(matrix.data() + 8);
+  const __m128 col3 = _mm_loadu_ps(matrix.data() + 12);
+  for (; i + 1 < count; ++i) {
+    const uint8_t * point_data = data + i * point_step;
+    const __m128 point = _mm_loadu_ps(reinterpret_cast<const float *>(point_data));
+    __m128 result = _mm_add_ps(col3, _mm_mul_ps(col0, _mm_shuffle_ps(point, point, 0x00)));
+    result = _mm_add_ps(result, _mm_mul_ps(col1, _mm_shuffle_ps(point, point, 0x55)));
+    result = _mm_add_ps(result, _mm_mul_ps(col2, _mm_shuffle_ps(point, point, 0xaa)));
+    _mm_storeu_ps(out_floats + 3 * i, result);
+    colors(i, point_data);
+  }
+#endif
+  for (; i < count; ++i) {
+    float xyz[3];
+    std::memcpy(xyz, data + i * point_step, sizeof(xyz));
+    const Eigen::Vector4f result = matrix * Eigen::Vector4f(xyz[0], xyz[1], xyz[2], 1.0f);
+    out[i] = Vector3(result.x(), result.y(), result.z());
+    colors(i, data + i * point_step);
+  }
+}
+
+/**
+ * @brief Dense point cloud conversion split into chunks for WorkerThreadPool.
+ */
+struct DenseConversionJob
+{
+  const uint8_t * data;
+  size_t point_step;
+  size_t num_points;
+  size_t chunk_size;
+  // Nullptr if the points are only converted to Godot's coordinate system
+  const Eigen::Matrix4f * transform;
+  Vector3 * out;
+  // Nullptr if no field is decoded into colors
+  const PointColorizer * colorizer;
+  Color * colors;
+  // One range per chunk if the colorizer defers mapping, nullptr otherwise
+  ScalarRange * ranges;
+
+  /**
+   * @brief Converts the points in [begin, end).
+   *
+   * @param range Range of the raw values of the points if the colorizer defers mapping.
+   */
+  void run(const size_t begin, const size_t end, ScalarRange * range) const
+  {
+    if (range) {
+      run(begin, end, ScalarColors{colorizer, colors + begin, range});
+    } else if (colorizer) {
+      run(begin, end, FieldColors{colorizer, colors + begin});
+    } else {
+      run(begin, end, NoColors{});
+    }
+  }
+
+  template <class ColorsT>
+  void run(const size_t begin, const size_t end, const ColorsT & chunk_colors) const
+  {
+    if (transform) {
+      transform_dense_xyz(
+        data + begin * point_step, point_step, end - begin, *transform, out + begin, chunk_colors);
+    } else {
+      convert_dense_xyz(
+        data + begin * point_step, point_step, end - begin, out + begin, chunk_colors);
+    }
+  }
+
+  /**
+   * @brief WorkerThreadPool entry point converting one chunk.
+   */
+  static void run_chunk(void * userdata, uint32_t chunk_index)
+  {
+    const auto * job = static_cast<const DenseConversionJob *>(userdata);
+    const size_t begin = static_cast<size_t>(chunk_index) * job->chunk_size;
+    job->run(
+      begin, std::min(begin + job->chunk_size, job->num_points),
+      job->ranges ? job->ranges + chunk_index : nullptr);
+  }
+};
+
+/**
+ * @brief Converts a dense point cloud, in parallel if it spans more than one chunk.
+ *
+ * Each chunk writes a disjoint range of the output. The kernels never write past the last point of
+ * their range, so chunks need no synchronization.
+ *
+ * @param colorizer Decodes the colors into the colors array if not nullptr.
+ * @param range Collects the range of the raw values if the colorizer defers mapping.
+ */
+void convert_dense_pointcloud(
+  const sensor_msgs::msg::PointCloud2 & msg, const size_t num_points,
+  const std::optional<Eigen::Matrix4f> & transform, const int chunk_size, Vector3 * out,
+  const PointColorizer * colorizer, Color * colors, ScalarRange & range)
+{
+  const bool defers_mapping = colorizer && colorizer->defers_mapping();
+  DenseConversionJob job{
+    msg.data.data(), msg.point_step, num_points, static_cast<size_t>(std::max(chunk_size, 0)),
+    transform ? &transform.value() : nullptr, out, colorizer, colors, nullptr};
+  if (job.chunk_size == 0 || num_points <= job.chunk_size) {
+    job.run(0, num_points, defers_mapping ? &range : nullptr);
+    return;
+  }
+
+  const size_t num_chunks = (num_points + job.chunk_size - 1) / job.chunk_size;
+  // Chunks collect their ranges separately and are merged after the conversion
+  std::vector<ScalarRange> chunk_ranges(defers_mapping ? num_chunks : 0);
+  if (defers_mapping) job.ranges = chunk_ranges.data();
+  WorkerThreadPool * pool = WorkerThreadPool::get_singleton();
+  const WorkerThreadPool::GroupID group_id = pool->add_native_group_task(
+    &DenseConversionJob::run_chunk, &job, static_cast<int>(num_chunks), -1, true,
+    "PointCloud conversion");
+  pool->wait_for_group_task_completion(group_id);
+  for (const auto & chunk_range : chunk_ranges) range.merge(chunk_range);
+}
+
+/**
+ * @brief Looks up the transform from the point cloud frame to a target frame.
  *
  * @param input The input point cloud.
  * @param tf2 The TF2 buffer for looking up transformations.
  * @param target_frame The target frame to which the point cloud will be transformed.
- * @param output The output transformed point cloud.
- * @return bool True if the transformation is successful, false otherwise.
+ * @return std::optional<Eigen::Matrix4f> Transform from the point cloud frame to Godot's coordinate
+ * system in the target frame, if found.
  */
-bool transform_pointcloud(
+std::optional<Eigen::Matrix4f> lookup_godot_transform(
   const sensor_msgs::msg::PointCloud2 & input, const tf2_ros::Buffer & tf2,
-  const std::string & target_frame, sensor_msgs::msg::PointCloud2 & output)
+  const std::string & target_frame)
 {
   rclcpp::Clock clock{RCL_ROS_TIME};
   geometry_msgs::msg::TransformStamped tf_stamped{};
   try {
+    // Never waits: callers run on the main thread or after TfMessageFilter found the transform
     tf_stamped = tf2.lookupTransform(
-      target_frame, input.header.frame_id, input.header.stamp, rclcpp::Duration::from_seconds(0.5));
+      target_frame, input.header.frame_id, input.header.stamp, rclcpp::Duration(0, 0));
   } catch (const tf2::TransformException & ex) {
     RCLCPP_WARN_THROTTLE(rclcpp::get_logger("godot_rviz2"), clock, 5000, "%s", ex.what());
-    return false;
+    return std::nullopt;
   }
   Eigen::Matrix4f tf_matrix = tf2::transformToEigen(tf_stamped.transform).matrix().cast<float>();
-  pcl_ros::transformPointCloud(tf_matrix, input, output);
-  output.header.stamp = input.header.stamp;
-  output.header.frame_id = target_frame;
-  return true;
+
+  // ROS 2 (x, y, z) to Godot (x, z, -y), see ros2_to_godot
+  Eigen::Matrix4f ros2_to_godot_matrix;
+  ros2_to_godot_matrix << 1, 0, 0, 0, 0, 0, 1, 0, 0, -1, 0, 0, 0, 0, 0, 1;
+  return ros2_to_godot_matrix * tf_matrix;
 }
 
-PackedVector3Array PointCloud::get_pointcloud(const String & frame_id)
+}  // namespace
+
+namespace
 {
-  PackedVector3Array pointcloud;
-  const auto last_msg = get_last_msg();
-  if (!last_msg) return pointcloud;
+/**
+ * @brief Replaces the points in each occupied voxel by their centroid and their average color.
+ */
+MeshArrays downsample_voxel_grid(const MeshArrays & pointcloud, const float voxel_size)
+{
+  struct Voxel
+  {
+    Vector3 sum;
+    Color color_sum;
+    uint32_t count;
+  };
+
+  // Voxel indices are packed into 21 bits per axis, which covers +-1048576 voxels
+  constexpr int64_t index_offset = 1 << 20;
+  constexpr int64_t index_mask = (1 << 21) - 1;
+  const auto voxel_key = [voxel_size](const Vector3 & point) {
+    const int64_t ix = static_cast<int64_t>(std::floor(point.x / voxel_size)) + index_offset;
+    const int64_t iy = static_cast<int64_t>(std::floor(point.y / voxel_size)) + index_offset;
+    const int64_t iz = static_cast<int64_t>(std::floor(point.z / voxel_size)) + index_offset;
+    return static_cast<uint64_t>(
+      ((ix & index_mask) << 42) | ((iy & index_mask) << 21) | (iz & index_mask));
+  };
+
+  const Vector3 * points = pointcloud.vertices.ptr();
+  const size_t num_points = pointcloud.vertices.size();
+  const bool has_colors = pointcloud.colors.size() == pointcloud.vertices.size();
+  const Color * colors = pointcloud.colors.ptr();
+  std::unordered_map<uint64_t, uint32_t> voxel_indices;
+  voxel_indices.reserve(num_points / 4);
+  std::vector<Voxel> voxels;
+  for (size_t i = 0; i < num_points; ++i) {
+    const Color color = has_colors ? colors[i] : Color();
+    const auto [it, inserted] =
+      voxel_indices.emplace(voxel_key(points[i]), static_cast<uint32_t>(voxels.size()));
+    if (inserted) {
+      voxels.push_back({points[i], color, 1});
+    } else {
+      auto & voxel = voxels[it->second];
+      voxel.sum += points[i];
+      voxel.color_sum += color;
+      ++voxel.count;
+    }
+  }
+
+  MeshArrays downsampled;
+  downsampled.vertices.resize(voxels.size());
+  Vector3 * out = downsampled.vertices.ptrw();
+  for (size_t i = 0; i < voxels.size(); ++i) {
+    out[i] = voxels[i].sum / static_cast<real_t>(voxels[i].count);
+  }
+  if (has_colors) {
+    downsampled.colors.resize(voxels.size());
+    Color * out_colors = downsampled.colors.ptrw();
+    for (size_t i = 0; i < voxels.size(); ++i) {
+      out_colors[i] = voxels[i].color_sum / static_cast<float>(voxels[i].count);
+    }
+  }
+  return downsampled;
+}
+}  // namespace
+
+PackedVector3Array downsample_voxel_grid(
+  const PackedVector3Array & pointcloud, const float voxel_size)
+{
+  MeshArrays points;
+  points.vertices = pointcloud;
+  return downsample_voxel_grid(points, voxel_size).vertices;
+}
+
+namespace
+{
+/**
+ * @brief Subsamples the points with a uniform stride to fit in a point budget.
+ *
+ * @param pointcloud The input points and their colors, if any.
+ * @param max_points Maximum number of output points.
+ * @return MeshArrays At most max_points points.
+ */
+MeshArrays limit_point_count(const MeshArrays & pointcloud, const size_t max_points)
+{
+  const size_t num_points = pointcloud.vertices.size();
+  if (num_points <= max_points) return pointcloud;
+
+  const auto subsample = [num_points, max_points](const auto & channel) {
+    std::remove_cv_t<std::remove_reference_t<decltype(channel)>> limited;
+    if (static_cast<size_t>(channel.size()) != num_points) return limited;
+    limited.resize(max_points);
+    const auto * src = channel.ptr();
+    auto * out = limited.ptrw();
+    for (size_t i = 0; i < max_points; ++i) {
+      out[i] = src[i * num_points / max_points];
+    }
+    return limited;
+  };
+  MeshArrays limited;
+  limited.vertices = subsample(pointcloud.vertices);
+  limited.colors = subsample(pointcloud.colors);
+  return limited;
+}
 
-  sensor_msgs::msg::PointCloud2::ConstSharedPtr msg_ptr;
-  msg_ptr = last_msg.value();
+/**
+ * @brief Applies the voxel grid filter and the point budget of the conversion parameters.
+ */
+MeshArrays downsample(const MeshArrays & pointcloud, const PointCloudConversionParam & param)
+{
+  MeshArrays downsampled = pointcloud;
+  if (param.voxel_size > 0.0) downsampled = downsample_voxel_grid(downsampled, param.voxel_size);
+  if (param.max_points > 0) downsampled = limit_point_count(downsampled, param.max_points);
+  return downsampled;
+}
+
+/**
+ * @brief Converts a point cloud message to Godot arrays in the specified frame.
+ *
+ * The transform to the target frame is fused into the conversion, so no transformed copy of the
+ * message is created. The color field is decoded in the same pass over the message.
+ *
+ * @param msg The point cloud message.
+ * @param param The conversion parameters.
+ * @return MeshArrays The converted points and, if a color field is set and found, their colors.
+ * Empty if the transform failed.
+ */
+MeshArrays convert_points(
+  const sensor_msgs::msg::PointCloud2 & msg, const PointCloudConversionParam & param)
+{
+  MeshArrays pointcloud;
 
   // Transform
-  std::shared_ptr<sensor_msgs::msg::PointCloud2> transformed_msg_ptr;
-  transformed_msg_ptr = std::make_shared<sensor_msgs::msg::PointCloud2>();
+  std::optional<Eigen::Matrix4f> transform;
   const auto tf_buffer = GodotRviz2::get_instance().get_tf_buffer();
-  if (to_std(frame_id) != last_msg.value()->header.frame_id) {
-    if (!transform_pointcloud(
-          *(last_msg.value()), *tf_buffer, to_std(frame_id), *transformed_msg_ptr))
-      return pointcloud;
-    msg_ptr = transformed_msg_ptr;
+  const std::string frame_id = to_std(param.frame_id);
+  if (frame_id != msg.header.frame_id) {
+    transform = lookup_godot_transform(msg, *tf_buffer, frame_id);
+    if (!transform) return pointcloud;
+  }
+
+  // Resolve the color field once for the whole message
+  PointColorizer colorizer(msg, param);
+  const size_t num_points = static_cast<size_t>(msg.width) * msg.height;
+  pointcloud.vertices.resize(num_points);
+  if (colorizer.get_mode() != PointColorizer::Mode::NONE) pointcloud.colors.resize(num_points);
+  Vector3 * out = pointcloud.vertices.ptrw();
+  Color * out_colors = pointcloud.colors.ptrw();
+
+  // Convert the point cloud to Godot arrays
+  size_t i = 0;
+  ScalarRange range;
+  if (has_dense_xyz_layout(msg)) {
+    convert_dense_pointcloud(
+      msg, num_points, transform, param.chunk_size, out,
+      colorizer.decodes_fields() ? &colorizer : nullptr, out_colors, range);
+    i = num_points;
+  } else {
+    sensor_msgs::PointCloud2ConstIterator<float> iter_x(msg, "x"), iter_y(msg, "y"),
+      iter_z(msg, "z");
+    for (; iter_x != iter_x.end() && i < num_points; ++iter_x, ++iter_y, ++iter_z, ++i) {
+      // Write each point to the Godot array after converting from ROS 2 to Godot's coordinate
+      // system
+      if (transform) {
+        const Eigen::Vector4f point =
+          transform.value() * Eigen::Vector4f(*iter_x, *iter_y, *iter_z, 1.0f);
+        out[i] = Vector3(point.x(), point.y(), point.z());
+      } else {
+        out[i] = ros2_to_godot(*iter_x, *iter_y, *iter_z);
+      }
+      if (colorizer.decodes_fields()) {
+        const uint8_t * point_data =
+          msg.data.data() + (i / msg.width) * msg.row_step + (i % msg.width) * msg.point_step;
+        if (colorizer.defers_mapping()) {
+          ScalarColors{&colorizer, out_colors, &range}(i, point_data);
+        } else {
+          out_colors[i] = colorizer.get_color(point_data);
+        }
+      }
+    }
+    pointcloud.vertices.resize(i);
+    if (!pointcloud.colors.is_empty()) pointcloud.colors.resize(i);
   }
 
-  // Convert the point cloud to a Godot array
-  sensor_msgs::PointCloud2ConstIterator<float> iter_x(*msg_ptr, "x"), iter_y(*msg_ptr, "y"),
-    iter_z(*msg_ptr, "z");
-  for (; iter_x != iter_x.end(); ++iter_x, ++iter_y, ++iter_z) {
-    // Append each point to the Godot array after converting from ROS 2 to Godot's coordinate system
-    pointcloud.append(ros2_to_godot(*iter_x, *iter_y, *iter_z));
+  // The height is only known after the transform, so it is read back from the converted points
+  if (colorizer.get_mode() == PointColorizer::Mode::HEIGHT) {
+    colorizer.color_by_height(pointcloud.vertices.ptr(), i, pointcloud.colors.ptrw());
   }
+  // Likewise the range of the field, but its values were read in the same pass as the positions
+  if (colorizer.defers_mapping()) colorizer.map_scalars(range, pointcloud.colors.ptrw(), i);
+  return pointcloud;
+}
 
+}  // namespace
+
+MeshArrays convert_pointcloud_arrays(
+  const sensor_msgs::msg::PointCloud2 & msg, const PointCloudConversionParam & param)
+{
+  return downsample(convert_points(msg, param), param);
+}
+
+PackedVector3Array convert_pointcloud(
+  const sensor_msgs::msg::PointCloud2 & msg, const PointCloudConversionParam & param)
+{
+  PointCloudConversionParam points_param = param;
+  points_param.color_field = String();
+  return convert_pointcloud_arrays(msg, points_param).vertices;
+}
+
+uint64_t hash_pointcloud(const sensor_msgs::msg::PointCloud2 & msg)
+{
+  uint64_t hash = DiskCache::hash_bytes(msg.header.frame_id.data(), msg.header.frame_id.size());
+  for (const auto & field : msg.fields) {
+    hash = DiskCache::hash_bytes(field.name.data(), field.name.size(), hash);
+    hash = DiskCache::hash_combine(hash, field.offset);
+    hash = DiskCache::hash_combine(hash, field.datatype);
+    hash = DiskCache::hash_combine(hash, field.count);
+  }
+  hash = DiskCache::hash_combine(hash, msg.height);
+  hash = DiskCache::hash_combine(hash, msg.width);
+  hash = DiskCache::hash_combine(hash, msg.point_step);
+  hash = DiskCache::hash_combine(hash, msg.is_bigendian);
+  return DiskCache::hash_bytes(msg.data.data(), msg.data.size(), hash);
+}
+
+namespace
+{
+/**
+ * @brief Hashes a point cloud message and the parameters it is converted with.
+ */
+uint64_t hash_pointcloud(
+  const sensor_msgs::msg::PointCloud2 & msg, const PointCloudConversionParam & param)
+{
+  // chunk_size does not change the result
+  uint64_t hash = DiskCache::hash_combine(hash_pointcloud(msg), param.frame_id.hash64());
+  hash = DiskCache::hash_bytes(&param.voxel_size, sizeof(param.voxel_size), hash);
+  hash = DiskCache::hash_combine(hash, param.max_points);
+  hash = DiskCache::hash_combine(hash, param.color_field.hash64());
+  hash = DiskCache::hash_bytes(&param.color_min, sizeof(param.color_min), hash);
+  return DiskCache::hash_bytes(&param.color_max, sizeof(param.color_max), hash);
+}
+
+/**
+ * @brief Converts a point cloud message, going through the disk cache when it is enabled.
+ */
+MeshArrays convert_pointcloud_cached(
+  const DiskCache & disk_cache, const sensor_msgs::msg::PointCloud2 & msg,
+  const PointCloudConversionParam & param)
+{
+  if (!disk_cache.is_enabled()) return convert_pointcloud_arrays(msg, param);
+  // An empty Array is not stored, so failed conversions are retried
+  return MeshArrays::from_array(
+    disk_cache.get_or_convert<Array>(hash_pointcloud(msg, param), [&]() {
+      const MeshArrays pointcloud = convert_pointcloud_arrays(msg, param);
+      return pointcloud.size() > 0 ? pointcloud.to_array() : Array();
+    }));
+}
+}  // namespace
+
+PointCloud::PointCloud()
+: disk_cache_(std::make_shared<DiskCache>("pointcloud")),
+  tf_filter_(std::make_shared<TfMessageFilter>(rclcpp::Duration::from_seconds(0.5))),
+  precompute_(std::make_shared<PointCloudPrecompute>(
+    [disk_cache = disk_cache_](
+      const sensor_msgs::msg::PointCloud2 & msg, const PointCloudConversionParam & param) {
+      return convert_pointcloud_cached(*disk_cache, msg, param);
+    }))
+{
+  message_hook_ = [precompute = precompute_](const ConstSharedPtr & msg) {
+    precompute->on_message(msg);
+  };
+  // Hold precomputed messages back until their transform arrives, so neither the callback nor the
+  // getter has to wait for it
+  message_gate_ = [precompute = precompute_, tf_filter = tf_filter_](
+                    const ConstSharedPtr & msg, std::function<void()> publish) {
+    const auto param = precompute->get_param();
+    if (!param) {
+      publish();
+      return;
+    }
+    tf_filter->add(to_std(param->frame_id), msg->header, std::move(publish));
+  };
+}
+
+void PointCloud::_bind_methods()
+{
+  // Bind the get_pointcloud method to Godot
+  ClassDB::bind_method(D_METHOD("get_pointcloud"), &PointCloud::get_pointcloud);
+  ClassDB::bind_method(
+    D_METHOD("get_pointcloud_arrays", "frame_id"), &PointCloud::get_pointcloud_arrays,
+    DEFVAL("map"));
+  // Bind the precompute methods to Godot
+  ClassDB::bind_method(
+    D_METHOD("enable_precompute", "frame_id"), &PointCloud::enable_precompute, DEFVAL("map"));
+  ClassDB::bind_method(D_METHOD("disable_precompute"), &PointCloud::disable_precompute);
+  // Bind the chunk_size property to Godot
+  ClassDB::bind_method(D_METHOD("set_chunk_size", "chunk_size"), &PointCloud::set_chunk_size);
+  ClassDB::bind_method(D_METHOD("get_chunk_size"), &PointCloud::get_chunk_size);
+  ADD_PROPERTY(PropertyInfo(Variant::INT, "chunk_size"), "set_chunk_size", "get_chunk_size");
+  // Bind the downsampling properties to Godot
+  ClassDB::bind_method(D_METHOD("set_voxel_size", "voxel_size"), &PointCloud::set_voxel_size);
+  ClassDB::bind_method(D_METHOD("get_voxel_size"), &PointCloud::get_voxel_size);
+  ClassDB::bind_method(D_METHOD("set_max_points", "max_points"), &PointCloud::set_max_points);
+  ClassDB::bind_method(D_METHOD("get_max_points"), &PointCloud::get_max_points);
+  ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "voxel_size"), "set_voxel_size", "get_voxel_size");
+  ADD_PROPERTY(PropertyInfo(Variant::INT, "max_points"), "set_max_points", "get_max_points");
+  // Bind the color properties to Godot
+  ClassDB::bind_method(D_METHOD("set_color_field", "field"), &PointCloud::set_color_field);
+  ClassDB::bind_method(D_METHOD("get_color_field"), &PointCloud::get_color_field);
+  ClassDB::bind_method(D_METHOD("set_color_range", "range"), &PointCloud::set_color_range);
+  ClassDB::bind_method(D_METHOD("get_color_range"), &PointCloud::get_color_range);
+  ADD_PROPERTY(PropertyInfo(Variant::STRING, "color_field"), "set_color_field", "get_color_field");
+  ADD_PROPERTY(PropertyInfo(Variant::VECTOR2, "color_range"), "set_color_range", "get_color_range");
+  // Bind the disk_cache property to Godot
+  ClassDB::bind_method(D_METHOD("set_disk_cache", "enabled"), &PointCloud::set_disk_cache);
+  ClassDB::bind_method(D_METHOD("is_disk_cache_enabled"), &PointCloud::is_disk_cache_enabled);
+  ADD_PROPERTY(
+    PropertyInfo(Variant::BOOL, "disk_cache"), "set_disk_cache", "is_disk_cache_enabled");
+  TOPIC_SUBSCRIBER_BIND_METHODS(PointCloud);
+}
+
+PointCloudConversionParam PointCloud::make_param(const String & frame_id) const
+{
+  PointCloudConversionParam param;
+  param.frame_id = frame_id;
+  param.chunk_size = chunk_size_;
+  param.voxel_size = voxel_size_;
+  param.max_points = max_points_;
+  param.color_field = color_field_;
+  param.color_min = color_range_.x;
+  param.color_max = color_range_.y;
+  return param;
+}
+
+void PointCloud::enable_precompute(const String & frame_id)
+{
+  precompute_->enable(make_param(frame_id));
+}
+
+void PointCloud::update_precompute()
+{
+  if (const auto param = precompute_->get_param()) enable_precompute(param->frame_id);
+}
+
+void PointCloud::set_chunk_size(const int chunk_size)
+{
+  chunk_size_ = std::max(chunk_size, 0);
+  update_precompute();
+}
+
+void PointCloud::set_voxel_size(const float voxel_size)
+{
+  voxel_size_ = std::max(voxel_size, 0.0f);
+  update_precompute();
+}
+
+void PointCloud::set_max_points(const int max_points)
+{
+  max_points_ = std::max(max_points, 0);
+  update_precompute();
+}
+
+void PointCloud::set_color_field(const String & field)
+{
+  color_field_ = field;
+  update_precompute();
+}
+
+void PointCloud::set_color_range(const Vector2 & range)
+{
+  color_range_ = range;
+  update_precompute();
+}
+
+void PointCloud::set_disk_cache(const bool enabled) { disk_cache_->set_enabled(enabled); }
+
+void PointCloud::disable_precompute() { precompute_->disable(); }
+
+PackedVector3Array PointCloud::get_pointcloud(const String & frame_id)
+{
+  const auto timer = measure_conversion("get_pointcloud");
+  return get_latest_arrays(frame_id).vertices;
+}
+
+Array PointCloud::get_pointcloud_arrays(const String & frame_id)
+{
+  const auto timer = measure_conversion("get_pointcloud_arrays");
+  return get_latest_arrays(frame_id).to_array();
+}
+
+MeshArrays PointCloud::get_latest_arrays(const String & frame_id)
+{
+  const auto last_msg = get_last_msg();
+  if (!last_msg) return MeshArrays();
+
+  // Return the arrays prepared in the subscription callback if they match the request
+  const auto param = make_param(frame_id);
+  const auto precomputed = precompute_->get(last_msg.value());
+  if (precomputed && precomputed->param == param) return precomputed->result;
+
+  // Convert each message only once per parameter set
+  if (cached_msg_ == last_msg.value() && cached_param_ == param) return cached_pointcloud_;
+  const MeshArrays pointcloud = convert_pointcloud_cached(*disk_cache_, *last_msg.value(), param);
+  // An empty result may come from a missing transform, so it is retried on the next call
+  if (pointcloud.size() > 0) {
+    cached_msg_ = last_msg.value();
+    cached_param_ = param;
+    cached_pointcloud_ = pointcloud;
+  }
   return pointcloud;
 }
@@ -0,0 +1,334 @@
+//
+//  Copyright 2022 Yukihiro Saito. All rights reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#include "pointcloud_map.hpp"
+
+#include "util.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <unordered_map>
+
+namespace
+{
+/**
+ * @brief Checks whether the map can be transformed to the target frame without waiting.
+ *
+ * Without the transform the map would be converted to no tiles, which must not be kept: the map
+ * is latched, so the message is never received again.
+ */
+bool has_transform(const sensor_msgs::msg::PointCloud2 & msg, const PointCloudMapParam & param)
+{
+  const std::string frame_id = to_std(param.frame_id);
+  if (frame_id == msg.header.frame_id) return true;
+  const auto tf_buffer = GodotRviz2::get_instance().get_tf_buffer();
+  return tf_buffer->canTransform(
+    frame_id, msg.header.frame_id, rclcpp::Time(msg.header.stamp), rclcpp::Duration(0, 0));
+}
+
+/**
+ * @brief Splits a point cloud map into tiles and builds their LOD levels.
+ *
+ * @param msg The point cloud map message.
+ * @param param The tiling parameters.
+ * @return std::vector<PointCloudMapTile> The non-empty tiles.
+ */
+std::vector<PointCloudMapTile> build_tiles(
+  const sensor_msgs::msg::PointCloud2 & msg, const PointCloudMapParam & param)
+{
+  std::vector<PointCloudMapTile> tiles;
+  if (param.tile_size <= 0.0) return tiles;
+
+  PointCloudConversionParam conversion_param;
+  conversion_param.frame_id = param.frame_id;
+  conversion_param.chunk_size = param.chunk_size;
+  const PackedVector3Array pointcloud = convert_pointcloud(msg, conversion_param);
+  const Vector3 * points = pointcloud.ptr();
+  const size_t num_points = pointcloud.size();
+
+  // Assign each point to a tile and count the points per tile
+  std::unordered_map<uint64_t, uint32_t> tile_indices;
+  std::vector<uint32_t> point_tiles(num_points);
+  std::vector<size_t> tile_sizes;
+  for (size_t i = 0; i < num_points; ++i) {
+    const Vector2i key(
+      static_cast<int32_t>(std::floor(points[i].x / param.tile_size)),
+      static_cast<int32_t>(std::floor(points[i].z / param.tile_size)));
+    const uint64_t packed_key =
+      (static_cast<uint64_t>(static_cast<uint32_t>(key.x)) << 32) | static_cast<uint32_t>(key.y);
+    const auto [it, inserted] =
+      tile_indices.emplace(packed_key, static_cast<uint32_t>(tiles.size()));
+    if (inserted) {
+      PointCloudMapTile tile;
+      tile.key = key;
+      tiles.push_back(tile);
+      tile_sizes.push_back(0);
+    }
+    point_tiles[i] = it->second;
+    ++tile_sizes[it->second];
+  }
+
+  // Copy the points into their tiles
+  std::vector<PackedVector3Array> tile_points(tiles.size());
+  std::vector<Vector3 *> tile_writers(tiles.size());
+  const real_t max_real = std::numeric_limits<real_t>::max();
+  std::vector<Vector3> tile_min(tiles.size(), Vector3(max_real, max_real, max_real));
+  std::vector<Vector3> tile_max(tiles.size(), Vector3(-max_real, -max_real, -max_real));
+  for (size_t t = 0; t < tiles.size(); ++t) {
+    tile_points[t].resize(tile_sizes[t]);
+    tile_writers[t] = tile_points[t].ptrw();
+  }
+  for (size_t i = 0; i < num_points; ++i) {
+    const uint32_t t = point_tiles[i];
+    *(tile_writers[t]++) = points[i];
+    tile_min[t] = tile_min[t].min(points[i]);
+    tile_max[t] = tile_max[t].max(points[i]);
+  }
+
+  // Build the LOD levels
+  const int num_lods = std::max<int>(param.lod_voxel_sizes.size(), 1);
+  for (size_t t = 0; t < tiles.size(); ++t) {
+    auto & tile = tiles[t];
+    tile.aabb = AABB(tile_min[t], tile_max[t] - tile_min[t]);
+    tile.lods.reserve(num_lods);
+    for (int lod = 0; lod < num_lods; ++lod) {
+      const float voxel_size =
+        lod < param.lod_voxel_sizes.size() ? param.lod_voxel_sizes[lod] : 0.0;
+      tile.lods.push_back(
+        voxel_size > 0.0 ? downsample_voxel_grid(tile_points[t], voxel_size) : tile_points[t]);
+    }
+  }
+
+  return tiles;
+}
+
+/**
+ * @brief Packs tiles into an Array of Dictionaries for the disk cache.
+ */
+Array tiles_to_array(const std::vector<PointCloudMapTile> & tiles)
+{
+  Array tiles_array;
+  for (const auto & tile : tiles) {
+    Array lods;
+    for (const auto & lod : tile.lods) {
+      lods.append(lod);
+    }
+    Dictionary tile_dict;
+    tile_dict["key"] = tile.key;
+    tile_dict["aabb"] = tile.aabb;
+    tile_dict["lods"] = lods;
+    tiles_array.append(tile_dict);
+  }
+  return tiles_array;
+}
+
+/**
+ * @brief Unpacks tiles packed by tiles_to_array.
+ */
+std::vector<PointCloudMapTile> tiles_from_array(const Array & tiles_array)
+{
+  std::vector<PointCloudMapTile> tiles;
+  tiles.reserve(tiles_array.size());
+  for (int i = 0; i < tiles_array.size(); ++i) {
+    const Dictionary tile_dict = tiles_array[i];
+    const Array lods = tile_dict.get("lods", Array());
+    PointCloudMapTile tile;
+    tile.key = tile_dict.get("key", Vector2i());
+    tile.aabb = tile_dict.get("aabb", AABB());
+    tile.lods.reserve(lods.size());
+    for (int lod = 0; lod < lods.size(); ++lod) {
+      tile.lods.push_back(lods[lod]);
+    }
+    tiles.push_back(tile);
+  }
+  return tiles;
+}
+
+/**
+ * @brief Builds the tiles of a point cloud map, going through the disk cache when it is enabled.
+ */
+std::vector<PointCloudMapTile> build_tiles_cached(
+  const DiskCache & disk_cache, const sensor_msgs::msg::PointCloud2 & msg,
+  const PointCloudMapParam & param)
+{
+  if (!disk_cache.is_enabled()) return build_tiles(msg, param);
+
+  // chunk_size does not change the result
+  uint64_t key = DiskCache::hash_combine(hash_pointcloud(msg), param.frame_id.hash64());
+  key = DiskCache::hash_bytes(&param.tile_size, sizeof(param.tile_size), key);
+  key = DiskCache::hash_bytes(
+    param.lod_voxel_sizes.ptr(), param.lod_voxel_sizes.size() * sizeof(float), key);
+
+  Variant cached;
+  if (disk_cache.load(key, cached)) return tiles_from_array(cached);
+  auto tiles = build_tiles(msg, param);
+  if (!tiles.empty()) disk_cache.store(key, tiles_to_array(tiles));
+  return tiles;
+}
+}  // namespace
+
+PointCloudMap::PointCloudMap()
+: disk_cache_(std::make_shared<DiskCache>("pointcloud_map")),
+  precompute_(std::make_shared<TilesPrecompute>(
+    [disk_cache = disk_cache_](
+      const sensor_msgs::msg::PointCloud2 & msg, const PointCloudMapParam & param) {
+      return build_tiles_cached(*disk_cache, msg, param);
+    }))
+{
+  lod_voxel_sizes_.push_back(0.0);
+  lod_voxel_sizes_.push_back(0.5);
+  lod_voxel_sizes_.push_back(2.0);
+  lod_distances_.push_back(100.0);
+  lod_distances_.push_back(250.0);
+  lod_distances_.push_back(600.0);
+
+  // The map is latched and large, so the tiles are always built in the subscription callback
+  precompute_->enable(make_param());
+  // A map received before its transform is left to the getter, which builds it once TF arrives
+  message_hook_ = [precompute = precompute_](const ConstSharedPtr & msg) {
+    const auto param = precompute->get_param();
+    if (param && has_transform(*msg, *param)) precompute->on_message(msg);
+  };
+}
+
+void PointCloudMap::_bind_methods()
+{
+  // Bind the tile methods to Godot
+  ClassDB::bind_method(D_METHOD("get_tiles", "position"), &PointCloudMap::get_tiles);
+  ClassDB::bind_method(D_METHOD("get_tile_count"), &PointCloudMap::get_tile_count);
+  // Bind the tiling properties to Godot
+  ClassDB::bind_method(D_METHOD("set_frame_id", "frame_id"), &PointCloudMap::set_frame_id);
+  ClassDB::bind_method(D_METHOD("get_frame_id"), &PointCloudMap::get_frame_id);
+  ClassDB::bind_method(D_METHOD("set_tile_size", "tile_size"), &PointCloudMap::set_tile_size);
+  ClassDB::bind_method(D_METHOD("get_tile_size"), &PointCloudMap::get_tile_size);
+  ClassDB::bind_method(
+    D_METHOD("set_lod_voxel_sizes", "lod_voxel_sizes"), &PointCloudMap::set_lod_voxel_sizes);
+  ClassDB::bind_method(D_METHOD("get_lod_voxel_sizes"), &PointCloudMap::get_lod_voxel_sizes);
+  ClassDB::bind_method(
+    D_METHOD("set_lod_distances", "lod_distances"), &PointCloudMap::set_lod_distances);
+  ClassDB::bind_method(D_METHOD("get_lod_distances"), &PointCloudMap::get_lod_distances);
+  ADD_PROPERTY(PropertyInfo(Variant::STRING, "frame_id"), "set_frame_id", "get_frame_id");
+  ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "tile_size"), "set_tile_size", "get_tile_size");
+  ADD_PROPERTY(
+    PropertyInfo(Variant::PACKED_FLOAT32_ARRAY, "lod_voxel_sizes"), "set_lod_voxel_sizes",
+    "get_lod_voxel_sizes");
+  ADD_PROPERTY(
+    PropertyInfo(Variant::PACKED_FLOAT32_ARRAY, "lod_distances"), "set_lod_distances",
+    "get_lod_distances");
+  ClassDB::bind_method(D_METHOD("set_disk_cache", "enabled"), &PointCloudMap::set_disk_cache);
+  ClassDB::bind_method(D_METHOD("is_disk_cache_enabled"), &PointCloudMap::is_disk_cache_enabled);
+  ADD_PROPERTY(
+    PropertyInfo(Variant::BOOL, "disk_cache"), "set_disk_cache", "is_disk_cache_enabled");
+  TOPIC_SUBSCRIBER_BIND_METHODS(PointCloudMap);
+}
+
+PointCloudMapParam PointCloudMap::make_param() const
+{
+  PointCloudMapParam param;
+  param.frame_id = frame_id_;
+  param.tile_size = tile_size_;
+  param.lod_voxel_sizes = lod_voxel_sizes_;
+  param.chunk_size = 65536;
+  return param;
+}
+
+void PointCloudMap::set_frame_id(const String & frame_id)
+{
+  frame_id_ = frame_id;
+  precompute_->enable(make_param());
+}
+
+void PointCloudMap::set_tile_size(const float tile_size)
+{
+  tile_size_ = std::max(tile_size, 1.0f);
+  precompute_->enable(make_param());
+}
+
+void PointCloudMap::set_lod_voxel_sizes(const PackedFloat32Array & lod_voxel_sizes)
+{
+  lod_voxel_sizes_ = lod_voxel_sizes;
+  precompute_->enable(make_param());
+}
+
+void PointCloudMap::set_lod_distances(const PackedFloat32Array & lod_distances)
+{
+  lod_distances_ = lod_distances;
+}
+
+void PointCloudMap::set_disk_cache(const bool enabled) { disk_cache_->set_enabled(enabled); }
+
+std::shared_ptr<const std::vector<PointCloudMapTile>> PointCloudMap::get_latest_tiles()
+{
+  const auto last_msg = get_last_msg();
+  if (!last_msg) return nullptr;
+
+  const auto param = make_param();
+  const auto precomputed = precompute_->get(last_msg.value());
+  if (precomputed && precomputed->param == param) {
+    // Shares the ownership of the entry, which the next precomputed message replaces
+    return std::shared_ptr<const std::vector<PointCloudMapTile>>(
+      precomputed, &precomputed->result);
+  }
+
+  // The properties changed after the map was received, or its transform was missing then
+  if (cached_msg_ != last_msg.value() || !(cached_param_ == param)) {
+    if (!has_transform(*last_msg.value(), param)) return nullptr;
+    cached_tiles_ = std::make_shared<const std::vector<PointCloudMapTile>>(
+      build_tiles_cached(*disk_cache_, *last_msg.value(), param));
+    cached_msg_ = last_msg.value();
+    cached_param_ = param;
+  }
+  return cached_tiles_;
+}
+
+int PointCloudMap::get_tile_count()
+{
+  const auto timer = measure_conversion("get_tile_count");
+  const auto tiles = get_latest_tiles();
+  return tiles ? static_cast<int>(tiles->size()) : 0;
+}
+
+Array PointCloudMap::get_tiles(const Vector3 & position)
+{
+  const auto timer = measure_conversion("get_tiles");
+  Array tiles_array;
+  const auto tiles = get_latest_tiles();
+  if (!tiles) return tiles_array;
+
+  for (const auto & tile : *tiles) {
+    // Horizontal distance between the position and the tile
+    const Vector3 closest = position.clamp(tile.aabb.position, tile.aabb.get_end());
+    const real_t distance = Vector2(closest.x - position.x, closest.z - position.z).length();
+
+    const int num_lods = std::min<int>(tile.lods.size(), lod_distances_.size());
+    for (int lod = 0; lod < num_lods; ++lod) {
+      if (distance < lod_distances_[lod]) {
+        Dictionary tile_dict;
+        tile_dict["key"] = tile.key;
+        tile_dict["lod"] = lod;
+        tile_dict["aabb"] = tile.aabb;
+        tile_dict["points"] = tile.lods[lod];
+        tiles_array.append(tile_dict);
+        break;
+      }
+    }
+  }
+
+  return tiles_array;
+}
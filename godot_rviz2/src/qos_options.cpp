@@ -0,0 +1,67 @@
+//
+//  Copyright 2022 Yukihiro Saito. All rights reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#include "qos_options.hpp"
+
+#include "core/string/ustring.h"
+
+#include <algorithm>
+
+rclcpp::QoS make_qos(const Dictionary & options, rclcpp::QoS qos)
+{
+  if (options.has("history")) {
+    const String history = options["history"];
+    if (history == "keep_last") qos.keep_last(std::max(static_cast<int>(qos.depth()), 1));
+    if (history == "keep_all") qos.keep_all();
+  }
+  if (options.has("depth")) {
+    const int depth = options["depth"];
+    if (qos.history() != rclcpp::HistoryPolicy::KeepAll) qos.keep_last(std::max(depth, 1));
+  }
+  if (options.has("reliability")) {
+    const String reliability = options["reliability"];
+    if (reliability == "reliable") qos.reliable();
+    if (reliability == "best_effort") qos.best_effort();
+  }
+  if (options.has("durability")) {
+    const String durability = options["durability"];
+    if (durability == "volatile") qos.durability_volatile();
+    if (durability == "transient_local") qos.transient_local();
+  }
+  return qos;
+}
+
+rclcpp::SubscriptionOptions make_subscription_options(
+  const Dictionary & options, const rclcpp::QoS & qos)
+{
+  rclcpp::SubscriptionOptions subscription_options;
+  if (options.has("use_intra_process_comms")) {
+    bool use_intra_process_comms = options["use_intra_process_comms"];
+    // create_subscription throws for any other QoS, which would terminate Godot
+    if (
+      use_intra_process_comms && (qos.history() == rclcpp::HistoryPolicy::KeepAll ||
+                                  qos.durability() != rclcpp::DurabilityPolicy::Volatile)) {
+      RCLCPP_ERROR(
+        rclcpp::get_logger("godot_rviz2"),
+        "use_intra_process_comms requires keep_last history and volatile durability, ignored");
+      use_intra_process_comms = false;
+    }
+    subscription_options.use_intra_process_comm = use_intra_process_comms
+                                                     ? rclcpp::IntraProcessSetting::Enable
+                                                     : rclcpp::IntraProcessSetting::Disable;
+  }
+  return subscription_options;
+}
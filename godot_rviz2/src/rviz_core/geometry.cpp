@@ -0,0 +1,302 @@
+//
+//  Copyright 2022 Yukihiro Saito. All rights reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+//
+// Copyright 2022 TIER IV, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "rviz_core/geometry.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <iostream>
+
+namespace rviz_core
+{
+namespace
+{
+/**
+ * @brief Determines if a 2D polygon is defined in a clockwise manner.
+ *
+ * @param polygon_2d The 2D polygon to check.
+ * @param n The number of points in the polygon.
+ * @return True if the polygon is clockwise, false otherwise.
+ */
+bool is_clockwise(const Eigen::Vector2f * polygon_2d, const size_t n)
+{
+  // Use the first point of the polygon as a reference point
+  const double x_offset = polygon_2d[0].x();
+  const double y_offset = polygon_2d[0].y();
+
+  // Calculate the sum for determining the winding of the polygon
+  double sum = 0.0;
+  for (std::size_t i = 0; i < n; ++i) {
+    sum += (polygon_2d[i].x() - x_offset) * (polygon_2d[(i + 1) % n].y() - y_offset) -
+           (polygon_2d[i].y() - y_offset) * (polygon_2d[(i + 1) % n].x() - x_offset);
+  }
+
+  // If the area is negative, the polygon is clockwise
+  return sum < 0.0;
+}
+
+// Number of segments cylinders are approximated with
+constexpr size_t cylinder_segments = 12;
+
+/**
+ * @brief Gets the clockwise unit circle the cylinders are built from.
+ *
+ * Computed once, so cylinders only scale the table by their radius.
+ */
+const std::array<Eigen::Vector2f, cylinder_segments> & get_unit_circle()
+{
+  static const std::array<Eigen::Vector2f, cylinder_segments> unit_circle = []() {
+    std::array<Eigen::Vector2f, cylinder_segments> circle;
+    constexpr float n = static_cast<float>(cylinder_segments);
+    for (size_t i = 0; i < cylinder_segments; ++i) {
+      const float angle = (static_cast<float>(cylinder_segments - i) / n) * 2.0 * M_PI + M_PI / n;
+      circle[i] = Eigen::Vector2f(std::cos(angle), std::sin(angle));
+    }
+    return circle;
+  }();
+  return unit_circle;
+}
+
+/**
+ * @brief Appends an extruded polygon as indexed triangles.
+ *
+ * The top and bottom faces share their vertices between the triangles of the fan, and each side
+ * quad shares its four vertices between its two triangles. The polygon corners are transformed
+ * only once per ring.
+ *
+ * @param polygon_2d The clockwise 2D polygon to extrude.
+ * @param n The number of points in the polygon.
+ * @param height The height of the extrusion.
+ * @param translation The translation component of the polygon's transformation.
+ * @param quaternion The rotation component of the polygon's transformation.
+ * @param mesh Buffers the vertices, normals and indices are appended to, in Godot's axes.
+ */
+void append_polygon3d_indexed(
+  const Eigen::Vector2f * polygon_2d, const size_t n, float height,
+  const Eigen::Translation3f & translation, const Eigen::Quaternionf & quaternion,
+  MeshBuffers & mesh)
+{
+  // Check if the polygon has at least three vertices
+  if (n < 3) {
+    std::cerr << "Polygon size is less than 3" << std::endl;
+    return;
+  }
+
+  // Check if the polygon is defined in a clockwise direction
+  if (!is_clockwise(polygon_2d, n)) {
+    std::cerr << "Polygon is not clockwise" << std::endl;
+    return;
+  }
+
+  // Combine translation and rotation to form the transformation
+  const Eigen::Affine3f transform = translation * quaternion;
+
+  // Transform the top and bottom rings once
+  constexpr size_t max_stack_points = 64;
+  std::array<Eigen::Vector3f, max_stack_points> top_stack, bottom_stack;
+  std::vector<Eigen::Vector3f> top_heap, bottom_heap;
+  Eigen::Vector3f * top = top_stack.data();
+  Eigen::Vector3f * bottom = bottom_stack.data();
+  if (n > max_stack_points) {
+    top_heap.resize(n);
+    bottom_heap.resize(n);
+    top = top_heap.data();
+    bottom = bottom_heap.data();
+  }
+  for (size_t i = 0; i < n; ++i) {
+    const Eigen::Vector2f & point = polygon_2d[i];
+    top[i] = transform * Eigen::Vector3f(point.x(), point.y(), height / 2);
+    bottom[i] = transform * Eigen::Vector3f(point.x(), point.y(), -height / 2);
+  }
+
+  // n vertices per cap and 4 per side, 3 (n - 2) indices per cap and 6 per side
+  mesh.reserve(6 * n);
+  auto & indices = mesh.indices;
+  reserve_additional(indices, 6 * (n - 2) + 6 * n);
+
+  // Process the top face
+  const Eigen::Vector3f top_normal =
+    ros2_to_godot(cross_product(top[2] - top[0], top[1] - top[0]));
+  const int32_t top_offset = mesh.size();
+  for (size_t i = 0; i < n; ++i) {
+    mesh.append(ros2_to_godot(top[i]), top_normal);
+  }
+  for (size_t i = 2; i < n; ++i) {
+    indices.insert(
+      indices.end(), {top_offset, top_offset + int32_t(i) - 1, top_offset + int32_t(i)});
+  }
+
+  // Process the side faces
+  for (size_t i = 0; i < n; ++i) {
+    const size_t j = (i + 1) % n;
+    const Eigen::Vector3f side_normal =
+      ros2_to_godot(cross_product(bottom[j] - top[i], bottom[i] - top[i]));
+    const int32_t side_offset = mesh.size();
+    mesh.append(ros2_to_godot(top[i]), side_normal);
+    mesh.append(ros2_to_godot(bottom[i]), side_normal);
+    mesh.append(ros2_to_godot(bottom[j]), side_normal);
+    mesh.append(ros2_to_godot(top[j]), side_normal);
+    indices.insert(
+      indices.end(), {side_offset, side_offset + 1, side_offset + 2, side_offset, side_offset + 2,
+                      side_offset + 3});
+  }
+
+  // Process the bottom face
+  const Eigen::Vector3f bottom_normal = -top_normal;
+  const int32_t bottom_offset = mesh.size();
+  for (size_t i = 0; i < n; ++i) {
+    mesh.append(ros2_to_godot(bottom[i]), bottom_normal);
+  }
+  for (size_t i = 2; i < n; ++i) {
+    indices.insert(
+      indices.end(), {bottom_offset, bottom_offset + int32_t(i), bottom_offset + int32_t(i) - 1});
+  }
+}
+
+/**
+ * @brief Replaces the buffers by a non-indexed copy of an indexed mesh.
+ */
+void expand_indices(const MeshBuffers & indexed, MeshBuffers & mesh)
+{
+  mesh = MeshBuffers();
+  mesh.reserve(indexed.indices.size());
+  for (const int32_t index : indexed.indices) {
+    const float * vertex = &indexed.vertices[3 * index];
+    const float * normal = &indexed.normals[3 * index];
+    mesh.vertices.insert(mesh.vertices.end(), vertex, vertex + 3);
+    mesh.normals.insert(mesh.normals.end(), normal, normal + 3);
+  }
+}
+
+/**
+ * @brief Copies the points of a polygon message into 2D vectors.
+ */
+std::vector<Eigen::Vector2f> to_polygon_2d(const geometry_msgs::msg::Polygon & polygon)
+{
+  std::vector<Eigen::Vector2f> polygon_2d;
+  polygon_2d.reserve(polygon.points.size());
+  for (const auto & point : polygon.points) {
+    polygon_2d.emplace_back(point.x, point.y);
+  }
+  return polygon_2d;
+}
+}  // namespace
+
+Eigen::Vector3f cross_product(const Eigen::Vector3f & a, const Eigen::Vector3f & b)
+{
+  return Eigen::Vector3f(
+    a.y() * b.z() - a.z() * b.y(), a.z() * b.x() - a.x() * b.z(), a.x() * b.y() - a.y() * b.x());
+}
+
+void generate_boundingbox3d(
+  float width, float height, float length, const Eigen::Translation3f & translation,
+  const Eigen::Quaternionf & quaternion, MeshBuffers & mesh)
+{
+  MeshBuffers indexed;
+  generate_boundingbox3d_indexed(width, height, length, translation, quaternion, indexed);
+  expand_indices(indexed, mesh);
+}
+
+void generate_cylinder3d(
+  float radius, float height, const Eigen::Translation3f & translation,
+  const Eigen::Quaternionf & quaternion, MeshBuffers & mesh)
+{
+  MeshBuffers indexed;
+  generate_cylinder3d_indexed(radius, height, translation, quaternion, indexed);
+  expand_indices(indexed, mesh);
+}
+
+void generate_polygon3d(
+  const geometry_msgs::msg::Polygon & polygon_2d, float height,
+  const Eigen::Translation3f & translation, const Eigen::Quaternionf & quaternion,
+  MeshBuffers & mesh)
+{
+  generate_polygon3d(to_polygon_2d(polygon_2d), height, translation, quaternion, mesh);
+}
+
+void generate_polygon3d(
+  const std::vector<Eigen::Vector2f> & polygon_2d, float height,
+  const Eigen::Translation3f & translation, const Eigen::Quaternionf & quaternion,
+  MeshBuffers & mesh)
+{
+  // The indexed triangles are in the same order as the non-indexed ones
+  MeshBuffers indexed;
+  generate_polygon3d_indexed(polygon_2d, height, translation, quaternion, indexed);
+  expand_indices(indexed, mesh);
+}
+
+void generate_boundingbox3d_indexed(
+  float width, float height, float length, const Eigen::Translation3f & translation,
+  const Eigen::Quaternionf & quaternion, MeshBuffers & mesh)
+{
+  // Create the 2D rectangle vertices
+  const std::array<Eigen::Vector2f, 4> polygon_2d = {
+    Eigen::Vector2f{width / 2, length / 2}, Eigen::Vector2f{width / 2, -length / 2},
+    Eigen::Vector2f{-width / 2, -length / 2}, Eigen::Vector2f{-width / 2, length / 2}};
+
+  append_polygon3d_indexed(
+    polygon_2d.data(), polygon_2d.size(), height, translation, quaternion, mesh);
+}
+
+void generate_cylinder3d_indexed(
+  float radius, float height, const Eigen::Translation3f & translation,
+  const Eigen::Quaternionf & quaternion, MeshBuffers & mesh)
+{
+  // Scale the precomputed unit circle to the radius
+  const auto & unit_circle = get_unit_circle();
+  std::array<Eigen::Vector2f, cylinder_segments> polygon_2d;
+  for (size_t i = 0; i < cylinder_segments; ++i) {
+    polygon_2d[i] = unit_circle[i] * radius;
+  }
+
+  append_polygon3d_indexed(
+    polygon_2d.data(), polygon_2d.size(), height, translation, quaternion, mesh);
+}
+
+void generate_polygon3d_indexed(
+  const geometry_msgs::msg::Polygon & polygon_2d, float height,
+  const Eigen::Translation3f & translation, const Eigen::Quaternionf & quaternion,
+  MeshBuffers & mesh)
+{
+  generate_polygon3d_indexed(to_polygon_2d(polygon_2d), height, translation, quaternion, mesh);
+}
+
+void generate_polygon3d_indexed(
+  const std::vector<Eigen::Vector2f> & polygon_2d, float height,
+  const Eigen::Translation3f & translation, const Eigen::Quaternionf & quaternion,
+  MeshBuffers & mesh)
+{
+  append_polygon3d_indexed(
+    polygon_2d.data(), polygon_2d.size(), height, translation, quaternion, mesh);
+}
+}  // namespace rviz_core
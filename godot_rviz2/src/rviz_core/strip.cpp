@@ -0,0 +1,202 @@
+//
+//  Copyright 2022 Yukihiro Saito. All rights reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#include "rviz_core/strip.hpp"
+
+#include "rviz_core/geometry.hpp"
+
+#include <array>
+#include <cmath>
+
+namespace rviz_core
+{
+namespace
+{
+/**
+ * @brief Gets the normalized direction of the segment starting at a point in the xy plane.
+ */
+Eigen::Vector2f get_segment_direction(const std::vector<Eigen::Vector3f> & points, const size_t i)
+{
+  return (points[i + 1] - points[i]).head<2>().normalized();
+}
+
+// Longest offset of a mitered vertex, in half widths. Limits the spikes of sharp corners.
+constexpr float miter_limit = 4.0;
+
+/**
+ * @brief Appends the vertices of the line points from the given one on.
+ *
+ * Each point is offset perpendicular to its tangent, the normalized sum of the directions of the
+ * adjacent segments, so no angle has to be computed or turned back into a rotation.
+ *
+ * @param points The points of the line, at least two.
+ * @param start The first point to append.
+ * @param width The width of the strip.
+ * @param miter Whether to lengthen the offsets at corners, see LineStripBuilder::update.
+ * @param triangle_strip Triangle strip holding the vertices of the points before start.
+ */
+void append_line_strip(
+  const std::vector<Eigen::Vector3f> & points, const size_t start, const float width,
+  const bool miter, MeshBuffers & triangle_strip)
+{
+  const size_t n = points.size();
+  triangle_strip.reserve(2 * (n - start));
+  // Every vertex of the flat strip faces up
+  const Eigen::Vector3f godot_normal = ros2_to_godot(Eigen::Vector3f::UnitZ());
+  // Direction of the segment ending at the current point
+  Eigen::Vector2f back_vec =
+    start > 0 ? get_segment_direction(points, start - 1) : Eigen::Vector2f::Zero();
+
+  for (size_t i = start; i < n; ++i) {
+    const Eigen::Vector2f front_vec =
+      i + 1 < n ? get_segment_direction(points, i) : Eigen::Vector2f::Zero();
+    Eigen::Vector2f tangent = front_vec + back_vec;
+    const float squared_norm = tangent.squaredNorm();
+    // Degenerate tangents face along x, as atan2(0, 0) did
+    tangent = squared_norm > 0 ? Eigen::Vector2f(tangent / std::sqrt(squared_norm))
+                               : Eigen::Vector2f::UnitX();
+
+    float half_width = width / 2;
+    // Only corners between two segments of nonzero length are mitered. A repeated or vertically
+    // stacked point has a zero direction, whose cosine to the tangent would hit the miter limit.
+    if (miter && back_vec.squaredNorm() > 0 && front_vec.squaredNorm() > 0) {
+      // The tangent is the bisector, so its cosine to a segment is the cosine of half the turn
+      half_width /= std::max(tangent.dot(front_vec), 1 / miter_limit);
+    }
+
+    const Eigen::Vector3f lateral_offset(-tangent.y() * half_width, tangent.x() * half_width, 0);
+    triangle_strip.append(ros2_to_godot(points[i] - lateral_offset), godot_normal);
+    triangle_strip.append(ros2_to_godot(points[i] + lateral_offset), godot_normal);
+    back_vec = front_vec;
+  }
+}
+
+/**
+ * @brief Copies the positions of a line in single precision.
+ */
+std::vector<Eigen::Vector3f> to_line_points(const std::vector<geometry_msgs::msg::Point> & line)
+{
+  std::vector<Eigen::Vector3f> points;
+  points.reserve(line.size());
+  for (const auto & point : line) {
+    points.emplace_back(point.x, point.y, point.z);
+  }
+  return points;
+}
+}  // namespace
+
+void append_strip_pair(
+  MeshBuffers & triangle_strip, const Eigen::Matrix3f & basis, const Eigen::Vector3f & position,
+  const float half_width)
+{
+  const Eigen::Vector3f lateral_offset = basis.col(1) * half_width;
+  const Eigen::Vector3f godot_normal = ros2_to_godot(Eigen::Vector3f(basis.col(2)));
+  triangle_strip.append(ros2_to_godot(position - lateral_offset), godot_normal);
+  triangle_strip.append(ros2_to_godot(position + lateral_offset), godot_normal);
+}
+
+void append_pose_strip_point(
+  MeshBuffers & triangle_strip, const PoseStripPoint & point, const float width)
+{
+  const auto & v = point.values;
+  const Eigen::Quaternionf quat(v[6], v[3], v[4], v[5]);
+  append_strip_pair(
+    triangle_strip, quat.toRotationMatrix(), Eigen::Vector3f(v[0], v[1], v[2]), width / 2);
+  triangle_strip.velocities.insert(triangle_strip.velocities.end(), {v[7], v[7]});
+}
+
+void PoseStripBuilder::clear()
+{
+  points_.clear();
+  strip_ = MeshBuffers();
+  reused_points_ = 0;
+}
+
+MeshBuffers generate_line_strip(
+  const std::vector<geometry_msgs::msg::Point> & line, float width, const bool miter)
+{
+  MeshBuffers line_triangle_points;
+  if (line.size() < 2) return line_triangle_points;
+  append_line_strip(to_line_points(line), 0, width, miter, line_triangle_points);
+  return line_triangle_points;
+}
+
+bool LineStripBuilder::update(
+  const std::vector<geometry_msgs::msg::Point> & line, const float width, const bool miter)
+{
+  if (width != width_ || miter != miter_) {
+    clear();
+    width_ = width;
+    miter_ = miter;
+  }
+
+  // Lines too short for a strip generate nothing
+  if (line.size() < 2) {
+    const bool changed = !points_.empty();
+    clear();
+    return changed;
+  }
+
+  // Find the first point that differs from the previous update
+  const auto points = to_line_points(line);
+  const size_t common = std::min(points.size(), points_.size());
+  size_t prefix = 0;
+  while (prefix < common && points_[prefix] == points[prefix]) ++prefix;
+  if (prefix == points.size() && prefix == points_.size()) return false;
+
+  // The orientation of the point before the first change depends on the changed point
+  const size_t start = prefix > 0 ? prefix - 1 : 0;
+  points_ = points;
+  strip_.truncate(2 * start);
+  append_line_strip(points_, start, width, miter, strip_);
+  return true;
+}
+
+void LineStripBuilder::clear()
+{
+  points_.clear();
+  strip_ = MeshBuffers();
+}
+
+MeshBuffers generate_wall_strip(
+  const geometry_msgs::msg::Pose & pose, const float width, const float height,
+  const float length_offset)
+{
+  const Eigen::Quaternionf quat(
+    pose.orientation.w, pose.orientation.x, pose.orientation.y, pose.orientation.z);
+  const Eigen::Vector3f position(pose.position.x, pose.position.y, pose.position.z);
+  const float half_width = width / 2.0;
+
+  // Define local points for the wall
+  const std::array<Eigen::Vector3f, 4> local_points = {
+    Eigen::Vector3f(length_offset, -half_width, 0), Eigen::Vector3f(length_offset, half_width, 0),
+    Eigen::Vector3f(length_offset, -half_width, height),
+    Eigen::Vector3f(length_offset, half_width, height)};
+
+  // Define the rotated normal
+  const Eigen::Vector3f godot_normal = ros2_to_godot(quat * Eigen::Vector3f(-1, 0, 0));
+
+  // Transform and append each point to the triangle strip
+  MeshBuffers triangle_strip;
+  triangle_strip.reserve(local_points.size());
+  for (size_t j = 0; j < local_points.size(); j++) {
+    triangle_strip.append(ros2_to_godot(position + quat * local_points[j]), godot_normal);
+    // Red for the base, transparent red for the top
+    triangle_strip.append_color(1.0, 0.0, 0.0, j < 2 ? 1.0 : 0.0);
+  }
+  return triangle_strip;
+}
+}  // namespace rviz_core
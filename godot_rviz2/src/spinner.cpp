@@ -23,4 +23,8 @@ void GodotRviz2Spinner::_bind_methods()
 {
   // Bind the spin_some method to Godot
   ClassDB::bind_method(D_METHOD("spin_some"), &GodotRviz2Spinner::spin_some);
+  // Bind the background executor methods to Godot
+  ClassDB::bind_method(D_METHOD("start", "num_threads"), &GodotRviz2Spinner::start, DEFVAL(0));
+  ClassDB::bind_method(D_METHOD("stop"), &GodotRviz2Spinner::stop);
+  ClassDB::bind_method(D_METHOD("is_running"), &GodotRviz2Spinner::is_running);
 }
@@ -38,6 +38,7 @@ void SteeringReport::_bind_methods()
  */
 double SteeringReport::get_angle()
 {
+  const auto timer = measure_conversion("get_angle");
   // Retrieve the last SteeringReport message
   const auto last_msg = get_last_msg();
   // Return 0.0 if no message is found
@@ -0,0 +1,68 @@
+//
+//  Copyright 2022 Yukihiro Saito. All rights reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#include "tf_cache.hpp"
+
+#include "core/config/engine.h"
+#include "util.hpp"
+
+#include <functional>
+
+size_t TfCache::KeyHash::operator()(const Key & key) const
+{
+  size_t hash = std::hash<std::string>()(key.source_frame_id);
+  hash = hash * 31 + std::hash<std::string>()(key.target_frame_id);
+  return hash * 31 + std::hash<int64_t>()(key.stamp);
+}
+
+std::optional<geometry_msgs::msg::Transform> TfCache::lookup(
+  const std::string & source_frame_id, const std::string & target_frame_id,
+  const rclcpp::Time & time)
+{
+  const auto transform_stamped = lookup_stamped(source_frame_id, target_frame_id, time);
+  if (!transform_stamped) return std::nullopt;
+  return transform_stamped.value().transform;
+}
+
+std::optional<geometry_msgs::msg::TransformStamped> TfCache::lookup_stamped(
+  const std::string & source_frame_id, const std::string & target_frame_id,
+  const rclcpp::Time & time)
+{
+  Key key{source_frame_id, target_frame_id, time.nanoseconds()};
+  const uint64_t frame = Engine::get_singleton()->get_process_frames();
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (frame != frame_) {
+      transforms_.clear();
+      frame_ = frame;
+    }
+    const auto it = transforms_.find(key);
+    if (it != transforms_.end()) return it->second;
+  }
+
+  // Look up without holding the lock, the TF2 buffer may wait for the transformation
+  const auto transform =
+    get_transform_stamped(*tf_buffer_, source_frame_id, target_frame_id, time);
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (frame == frame_) transforms_.emplace(std::move(key), transform);
+  return transform;
+}
+
+void TfCache::clear()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  transforms_.clear();
+}
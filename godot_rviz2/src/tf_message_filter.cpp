@@ -0,0 +1,121 @@
+//
+//  Copyright 2022 Yukihiro Saito. All rights reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#include "tf_message_filter.hpp"
+
+#include "godot_rviz2.hpp"
+
+#include <tf2/exceptions.h>
+#include <tf2_ros/buffer.h>
+
+#include <utility>
+
+TfMessageFilter::TfMessageFilter(const rclcpp::Duration & timeout)
+: timeout_(timeout), state_(std::make_shared<State>())
+{
+}
+
+TfMessageFilter::~TfMessageFilter()
+{
+  {
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    state_->stop = true;
+    state_->ready = nullptr;
+    ++state_->generation;
+  }
+  state_->condition.notify_all();
+  if (worker_.joinable()) worker_.join();
+}
+
+void TfMessageFilter::add(
+  const std::string & target_frame_id, const std_msgs::msg::Header & header, Callback on_ready)
+{
+  uint64_t generation = 0;
+  {
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    // Drop the message that was waiting, or whose callback has not run yet
+    generation = ++state_->generation;
+    state_->ready = nullptr;
+  }
+
+  const auto tf_buffer = GodotRviz2::get_instance().get_tf_buffer();
+  const rclcpp::Time stamp(header.stamp);
+  if (
+    target_frame_id == header.frame_id ||
+    tf_buffer->canTransform(target_frame_id, header.frame_id, stamp, rclcpp::Duration(0, 0))) {
+    publish(state_, generation, on_ready);
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    if (!worker_.joinable()) worker_ = std::thread(&TfMessageFilter::run, state_);
+  }
+
+  const std::weak_ptr<State> weak_state = state_;
+  const auto on_transform = [weak_state, generation, on_ready = std::move(on_ready)](
+                              const tf2_ros::TransformStampedFuture & future) {
+    const auto state = weak_state.lock();
+    if (!state) return;
+    try {
+      future.get();
+    } catch (const tf2::TransformException &) {
+      // Timed out
+      return;
+    }
+    {
+      std::lock_guard<std::mutex> lock(state->mutex);
+      if (state->generation != generation) return;
+      state->ready = on_ready;
+      state->ready_generation = generation;
+    }
+    state->condition.notify_one();
+  };
+  try {
+    tf_buffer->waitForTransform(
+      target_frame_id, header.frame_id, tf2_ros::fromRclcpp(stamp), tf2_ros::fromRclcpp(timeout_),
+      on_transform);
+  } catch (const tf2::TransformException &) {
+    // Unknown frames or no timer interface, the message is dropped
+  }
+}
+
+void TfMessageFilter::run(const std::shared_ptr<State> & state)
+{
+  std::unique_lock<std::mutex> lock(state->mutex);
+  while (true) {
+    state->condition.wait(lock, [&state]() { return state->stop || state->ready; });
+    if (state->stop) return;
+    Callback ready = std::move(state->ready);
+    state->ready = nullptr;
+    const uint64_t generation = state->ready_generation;
+    lock.unlock();
+    publish(state, generation, ready);
+    lock.lock();
+  }
+}
+
+void TfMessageFilter::publish(
+  const std::shared_ptr<State> & state, const uint64_t generation, const Callback & on_ready)
+{
+  std::lock_guard<std::mutex> publish_lock(state->publish_mutex);
+  {
+    std::lock_guard<std::mutex> lock(state->mutex);
+    // Overtaken while waiting for the other thread, publishing it now would reorder the messages
+    if (state->generation != generation) return;
+  }
+  on_ready();
+}
@@ -0,0 +1,155 @@
+//
+//  Copyright 2022 Yukihiro Saito. All rights reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#include "topic_stats.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+void LatencyHistogram::record(const double seconds)
+{
+  const double value = std::max(seconds, 0.0);
+  const double octaves = value > min_seconds ? std::log2(value / min_seconds) : 0.0;
+  const size_t index =
+    std::min(static_cast<size_t>(octaves * buckets_per_octave), num_buckets - 1);
+  ++buckets_[index];
+  ++count_;
+  sum_ += value;
+  max_ = std::max(max_, value);
+}
+
+double LatencyHistogram::get_percentile(const double quantile) const
+{
+  if (count_ == 0) return 0.0;
+
+  const uint64_t rank = static_cast<uint64_t>(std::ceil(std::clamp(quantile, 0.0, 1.0) * count_));
+  uint64_t cumulative = 0;
+  for (size_t i = 0; i < num_buckets; ++i) {
+    cumulative += buckets_[i];
+    if (cumulative < std::max<uint64_t>(rank, 1)) continue;
+    // Geometric center of the bucket, capped by the largest sample
+    const double center = min_seconds * std::exp2((i + 0.5) / buckets_per_octave);
+    return std::min(center, max_);
+  }
+  return max_;
+}
+
+namespace
+{
+TopicStats::Percentiles summarize(const LatencyHistogram & histogram)
+{
+  TopicStats::Percentiles percentiles;
+  percentiles.count = histogram.get_count();
+  percentiles.mean = histogram.get_mean();
+  percentiles.p50 = histogram.get_percentile(0.5);
+  percentiles.p99 = histogram.get_percentile(0.99);
+  percentiles.max = histogram.get_max();
+  return percentiles;
+}
+}  // namespace
+
+void TopicStats::record_receive(const int64_t stamp_ns, const int64_t receive_ns)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  ++received_;
+  if (stamp_ns != 0) delivery_latency_.record((receive_ns - stamp_ns) * 1e-9);
+  receive_times_.push_back(receive_ns);
+  if (receive_times_.size() > rate_window) receive_times_.pop_front();
+}
+
+void TopicStats::record_publish()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  ++published_;
+}
+
+void TopicStats::record_consume(
+  const uint64_t num_published, const int64_t stamp_ns, const int64_t render_ns)
+{
+  if (num_published == 0) return;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  ++consumed_;
+  overwritten_ += num_published - 1;
+  if (stamp_ns != 0) render_latency_.record((render_ns - stamp_ns) * 1e-9);
+}
+
+void TopicStats::record_conversion(const std::string & name, const double seconds)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  conversions_[name].record(seconds);
+}
+
+TopicStats::Snapshot TopicStats::get_snapshot() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  Snapshot snapshot;
+  snapshot.topic = topic_;
+  snapshot.received = received_;
+  snapshot.dropped = received_ - std::min(published_, received_);
+  snapshot.overwritten = overwritten_;
+  snapshot.consumed = consumed_;
+  if (receive_times_.size() > 1 && receive_times_.back() > receive_times_.front()) {
+    snapshot.rate =
+      (receive_times_.size() - 1) / ((receive_times_.back() - receive_times_.front()) * 1e-9);
+  }
+  snapshot.delivery_latency = summarize(delivery_latency_);
+  snapshot.render_latency = summarize(render_latency_);
+  for (const auto & [name, histogram] : conversions_) {
+    snapshot.conversions.emplace(name, summarize(histogram));
+  }
+  return snapshot;
+}
+
+void TopicStats::reset()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  received_ = 0;
+  published_ = 0;
+  overwritten_ = 0;
+  consumed_ = 0;
+  receive_times_.clear();
+  delivery_latency_ = LatencyHistogram();
+  render_latency_ = LatencyHistogram();
+  conversions_.clear();
+}
+
+std::shared_ptr<TopicStats> TopicStatsRegistry::get_topic_stats(const std::string & topic)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto & stats = topics_[topic];
+  if (!stats) stats = std::make_shared<TopicStats>(topic);
+  return stats;
+}
+
+std::vector<TopicStats::Snapshot> TopicStatsRegistry::get_snapshots() const
+{
+  std::vector<std::shared_ptr<TopicStats>> topics;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto & [topic, stats] : topics_) topics.push_back(stats);
+  }
+  std::vector<TopicStats::Snapshot> snapshots;
+  snapshots.reserve(topics.size());
+  for (const auto & stats : topics) snapshots.push_back(stats->get_snapshot());
+  return snapshots;
+}
+
+void TopicStatsRegistry::reset()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const auto & [topic, stats] : topics_) stats->reset();
+}
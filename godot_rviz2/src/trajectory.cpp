@@ -16,10 +16,22 @@
 
 #include "trajectory.hpp"
 
+#include "rviz_core/strip.hpp"
+
 #include <string>
-#define EIGEN_MPL2_ONLY
-#include <eigen3/Eigen/Core>
-#include <eigen3/Eigen/Geometry>
+
+Trajectory::Trajectory()
+{
+  // The precomputed strips are built on the executor thread, so they get their own cache
+  precompute_ = std::make_shared<TriangleStripPrecompute>(
+    [cache = std::make_shared<StripCache<rviz_core::PoseStripBuilder>>()](
+      const autoware_auto_planning_msgs::msg::Trajectory & msg, const float & width) {
+      return cache->update(msg.points, width);
+    });
+  message_hook_ = [precompute = precompute_](const ConstSharedPtr & msg) {
+    precompute->on_message(msg);
+  };
+}
 
 /**
  * @brief Binds methods of Trajectory class to the Godot system.
@@ -31,71 +43,79 @@ void Trajectory::_bind_methods()
     D_METHOD("get_trajectory_triangle_strip"), &Trajectory::get_trajectory_triangle_strip);
   // Bind the get_wall_triangle_strip method to Godot
   ClassDB::bind_method(D_METHOD("get_wall_triangle_strip"), &Trajectory::get_wall_triangle_strip);
+  // Bind the packed array variants of the getters to Godot
+  ClassDB::bind_method(
+    D_METHOD("get_trajectory_triangle_strip_arrays", "width"),
+    &Trajectory::get_trajectory_triangle_strip_arrays);
+  ClassDB::bind_method(
+    D_METHOD(
+      "get_wall_triangle_strip_arrays", "width", "height", "length_offset", "ignore_start_point",
+      "ignore_end_point"),
+    &Trajectory::get_wall_triangle_strip_arrays);
+  // Bind the precompute methods to Godot
+  ClassDB::bind_method(D_METHOD("enable_precompute", "width"), &Trajectory::enable_precompute);
+  ClassDB::bind_method(D_METHOD("disable_precompute"), &Trajectory::disable_precompute);
   // Additional method bindings for the TOPIC_SUBSCRIBER
   TOPIC_SUBSCRIBER_BIND_METHODS(Trajectory);
 }
 
-Dictionary Trajectory::create_point_dict(
-  const Eigen::Quaternionf & quat, const Eigen::Vector3f & position, const float width_offset,
-  const float velocity)
+void Trajectory::enable_precompute(const float width) { precompute_->enable(width); }
+
+void Trajectory::disable_precompute() { precompute_->disable(); }
+
+Array Trajectory::get_trajectory_triangle_strip(const float width)
+{
+  const auto timer = measure_conversion("get_trajectory_triangle_strip");
+  return get_latest_trajectory_triangle_strip(width).to_point_dicts();
+}
+
+Array Trajectory::get_trajectory_triangle_strip_arrays(const float width)
 {
-  // Calculation of the rotated offset
-  Eigen::Vector3f local_offset, rotated_offset;
-  local_offset << 0, width_offset, 0;
-  rotated_offset = quat * local_offset;
-
-  // Conversion to Godot's coordinate system
-  Vector3 godot_position = ros2_to_godot(
-    position.x() + rotated_offset.x(), position.y() + rotated_offset.y(),
-    position.z() + rotated_offset.z());
-
-  // Calculation of the rotated normal
-  Eigen::Vector3f local_normal, rotated_normal;
-  local_normal << 0, 0, 1;
-  rotated_normal = quat * local_normal;
-  Vector3 godot_normal = ros2_to_godot(rotated_normal.x(), rotated_normal.y(), rotated_normal.z());
-
-  // Creating the dictionary with calculated values
-  Dictionary point_dict;
-  point_dict["velocity"] = velocity;
-  point_dict["position"] = godot_position;
-  point_dict["normal"] = godot_normal;
-  return point_dict;
+  const auto timer = measure_conversion("get_trajectory_triangle_strip_arrays");
+  return get_latest_trajectory_triangle_strip(width).to_array();
 }
 
-Array Trajectory::get_trajectory_triangle_strip(const float width)
+MeshArrays Trajectory::get_latest_trajectory_triangle_strip(const float width)
 {
-  // Initialize an empty array for the triangle strip
-  Array triangle_strip;
   // Retrieve the last trajectory message
   const auto last_msg = get_last_msg();
-  // If no message is found, return the empty array
-  if (!last_msg) return triangle_strip;
+  // If no message is found, return empty arrays
+  if (!last_msg) return MeshArrays();
 
-  // Iterate over each point in the trajectory message
-  for (const auto & point : last_msg.value()->points) {
-    // Extract pose information from the point
-    const auto & pose = point.pose;
-    Eigen::Quaternionf quat(
-      pose.orientation.w, pose.orientation.x, pose.orientation.y, pose.orientation.z);
-    Eigen::Vector3f position(pose.position.x, pose.position.y, pose.position.z);
-
-    // Append two points for each trajectory point to form a strip
-    triangle_strip.append(
-      create_point_dict(quat, position, -(width / 2.0), point.longitudinal_velocity_mps));
-    triangle_strip.append(
-      create_point_dict(quat, position, (width / 2.0), point.longitudinal_velocity_mps));
-  }
+  // Return the strip prepared in the subscription callback if it matches the request
+  const auto precomputed = precompute_->get(last_msg.value());
+  if (precomputed && precomputed->param == width) return precomputed->result;
 
-  return triangle_strip;
+  // Regenerate only the points that changed since the last call
+  return strip_cache_.update(last_msg.value()->points, width);
 }
 
 Array Trajectory::get_wall_triangle_strip(
   const float width, const float height, const float length_offset, const bool ignore_start_point,
   const bool ignore_end_point)
 {
-  // Initialize an empty array for the wall triangle strip
-  Array triangle_strip;
+  const auto timer = measure_conversion("get_wall_triangle_strip");
+  return convert_wall_triangle_strip(
+           width, height, length_offset, ignore_start_point, ignore_end_point)
+    .to_point_dicts();
+}
+
+Array Trajectory::get_wall_triangle_strip_arrays(
+  const float width, const float height, const float length_offset, const bool ignore_start_point,
+  const bool ignore_end_point)
+{
+  const auto timer = measure_conversion("get_wall_triangle_strip_arrays");
+  return convert_wall_triangle_strip(
+           width, height, length_offset, ignore_start_point, ignore_end_point)
+    .to_array();
+}
+
+MeshArrays Trajectory::convert_wall_triangle_strip(
+  const float width, const float height, const float length_offset, const bool ignore_start_point,
+  const bool ignore_end_point)
+{
+  // Initialize empty arrays for the wall triangle strip
+  MeshArrays triangle_strip;
   // Retrieve the last trajectory message
   const auto last_msg = get_last_msg();
   // If no message is found, return the empty array
@@ -115,46 +135,9 @@ Array Trajectory::get_wall_triangle_strip(
     constexpr float eps = 0.0001;
     // Only consider points with a velocity lower than the epsilon
     if (point.longitudinal_velocity_mps < eps) {
-      const auto & pose = point.pose;
-      Eigen::Quaternionf quat(
-        pose.orientation.w, pose.orientation.x, pose.orientation.y, pose.orientation.z);
-      Eigen::Vector3f position(pose.position.x, pose.position.y, pose.position.z);
-      const float half_width = width / 2.0;
-
-      // Define local points for the wall
-      std::vector<Eigen::Vector3f> local_points = {
-        Eigen::Vector3f(length_offset, -half_width, 0),
-        Eigen::Vector3f(length_offset, half_width, 0),
-        Eigen::Vector3f(length_offset, -half_width, height),
-        Eigen::Vector3f(length_offset, half_width, height)};
-
-      // Define the local and rotated normal
-      const Eigen::Vector3f local_normal(-1, 0, 0);
-      Eigen::Vector3f rotated_normal = quat * local_normal;
-
-      // Transform and append each point to the triangle strip
-      for (size_t j = 0; j < local_points.size(); j++) {
-        const auto & local_point = local_points[j];
-        Eigen::Vector3f rotated_point = quat * local_point;
-
-        Dictionary point_dict;
-        point_dict["position"] = ros2_to_godot(
-          position.x() + rotated_point.x(), position.y() + rotated_point.y(),
-          position.z() + rotated_point.z());
-        point_dict["normal"] =
-          ros2_to_godot(rotated_normal.x(), rotated_normal.y(), rotated_normal.z());
-        // Set color based on the position in the wall
-        if (j == 0 || j == 1) {
-          point_dict["color"] = Color(1.0, 0.0, 0.0, 1.0);  // Red color for the base
-        } else {
-          point_dict["color"] = Color(1.0, 0.0, 0.0, 0.0);  // Transparent red for the top
-        }
-
-        triangle_strip.append(point_dict);
-      }
-
-      // Break after the first point with velocity less than epsilon
-      break;
+      // Only the first point with velocity less than epsilon gets a wall
+      return MeshArrays::from_buffers(
+        rviz_core::generate_wall_strip(point.pose, width, height, length_offset));
     }
   }
   return triangle_strip;
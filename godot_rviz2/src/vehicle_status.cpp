@@ -41,6 +41,7 @@ void VehicleStatus::_bind_methods()
  */
 bool VehicleStatus::is_turn_on_right()
 {
+  const auto timer = measure_conversion("is_turn_on_right");
   // Retrieve the last TurnIndicatorsReport message
   const auto last_msg = get_last_msg();
   // Return false if no message is found
@@ -61,6 +62,7 @@ bool VehicleStatus::is_turn_on_right()
  */
 bool VehicleStatus::is_turn_on_left()
 {
+  const auto timer = measure_conversion("is_turn_on_left");
   // Retrieve the last TurnIndicatorsReport message
   const auto last_msg = get_last_msg();
   // Return false if no message is found
@@ -39,6 +39,7 @@ void VelocityReport::_bind_methods()
  */
 double VelocityReport::get_velocity()
 {
+  const auto timer = measure_conversion("get_velocity");
   // Retrieve the last VelocityReport message
   const auto last_msg = get_last_msg();
   // Return 0.0 if no message is found